@@ -0,0 +1,732 @@
+#include "delta.hpp"
+#include "query.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// The replacements below pair operator new with free, which GCC can't tell apart from a real mismatch.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+/// Number of calls to the global operator new, so every benchmark can report allocations per operation.
+static std::atomic<std::size_t> allocations = 0;
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef _WIN32
+    auto ptr = _aligned_malloc(size == 0 ? 1 : size, static_cast<std::size_t>(align));
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(static_cast<std::size_t>(align), sizeof(void*)), size == 0 ? 1 : size) != 0) {
+        ptr = nullptr;
+    }
+#endif
+
+    if (ptr) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t align) noexcept {
+    operator delete(ptr, align);
+}
+
+// Chunk layout of the C ABI, as a foreign caller declares it.
+struct FfiQuery;
+struct FfiQueryColumn {
+    std::byte* data;
+};
+struct FfiQueryChunk {
+    FfiQueryColumn* columns;
+    Entity* entities;
+    std::size_t entityCount;
+};
+
+extern "C" FfiQuery* _QueryCreate();
+extern "C" void _QueryDestroy(FfiQuery* query);
+extern "C" int _QueryIter(World* world, const Signature* fetchBitmask, FfiQuery* query, FfiQueryChunk** outChunks);
+extern "C" Entity _WorldSpawnBuffer(World* world, const Signature* bitmask, std::byte* buffer);
+
+template<std::size_t I>
+struct Data {
+    float value;
+};
+
+/// Components that only split entities into different archetypes.
+template<std::size_t I>
+struct Fragment {
+    int value;
+};
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+static_assert(sizeof(Position) == 3 * sizeof(float) && sizeof(Velocity) == 3 * sizeof(float));
+
+constexpr float deltaTime = 1.0f / 60.0f;
+
+/// Flag toggled on and off, kept in a sparse set.
+struct SparseFlag {
+    int value;
+};
+
+/// Tag toggled on and off. It only lives in archetype signatures.
+struct Marker {};
+
+constexpr std::size_t dataCount = 8;
+constexpr std::size_t fragmentCount = 10;
+
+/// Keeps results of the measured code alive so the optimizer can't drop it.
+static volatile float sink = 0.0f;
+
+struct Options {
+    std::size_t entities = 100'000;
+    std::size_t samples = 5;
+    std::string output = "bench.json";
+    std::string filter;
+};
+
+struct Result {
+    std::string name;
+    std::size_t ops;
+    double nsPerOp;
+    double opsPerSecond;
+    double allocationsPerOp;
+    /// Bytes produced per operation, for benchmarks whose `run` returns a byte count.
+    std::optional<double> bytesPerOp;
+};
+
+class Bench {
+public:
+    explicit Bench(Options options) : _options(std::move(options)) {}
+
+    /// Runs `setup` and then times `run` on its result, keeping the fastest of all samples. `run` performs
+    /// `ops` operations, each on one entity. Setup and teardown of the state are excluded from the timing.
+    /// When `run` returns the number of bytes it produced, bytes per operation are reported as well.
+    template<typename Setup, typename Run>
+    void measure(const std::string& name, std::size_t ops, Setup&& setup, Run&& run) {
+        if (!this->_options.filter.empty() && name.find(this->_options.filter) == std::string::npos) {
+            return;
+        }
+
+        auto best = std::numeric_limits<double>::max();
+        auto bestAllocations = std::numeric_limits<std::size_t>::max();
+        std::optional<std::size_t> bytes;
+
+        for (std::size_t sample = 0; sample < this->_options.samples; ++sample) {
+            auto state = setup();
+
+            auto allocationsBefore = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+
+            if constexpr (std::is_same_v<decltype(run(state)), std::size_t>) {
+                bytes = run(state);
+            } else {
+                run(state);
+            }
+
+            auto end = std::chrono::steady_clock::now();
+            auto allocationsAfter = allocations.load(std::memory_order_relaxed);
+
+            best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+            bestAllocations = std::min(bestAllocations, allocationsAfter - allocationsBefore);
+        }
+
+        auto result = Result{
+            .name = name,
+            .ops = ops,
+            .nsPerOp = best / double(ops),
+            .opsPerSecond = double(ops) / (best * 1e-9),
+            .allocationsPerOp = double(bestAllocations) / double(ops),
+            .bytesPerOp = bytes ? std::optional(double(*bytes) / double(ops)) : std::nullopt,
+        };
+
+        std::print(
+            "{:<36} {:>12.2f} ns/op {:>16.0f} entities/s {:>10.3f} allocs/op",
+            result.name, result.nsPerOp, result.opsPerSecond, result.allocationsPerOp
+        );
+
+        if (result.bytesPerOp) {
+            std::print(" {:>12.1f} bytes/op", *result.bytesPerOp);
+        }
+        std::println("");
+
+        this->_results.push_back(std::move(result));
+    }
+
+    /// Writes every result as JSON, so runs of different releases can be compared by a script.
+    bool write() const {
+        auto file = std::fopen(this->_options.output.c_str(), "w");
+
+        if (!file) {
+            return false;
+        }
+
+        std::println(file, "{{");
+        std::println(file, "  \"entities\": {},", this->_options.entities);
+        std::println(file, "  \"samples\": {},", this->_options.samples);
+        std::println(file, "  \"results\": [");
+
+        for (std::size_t i = 0; i < this->_results.size(); ++i) {
+            const auto& result = this->_results[i];
+
+            std::print(
+                file,
+                "    {{\"name\": \"{}\", \"ops\": {}, \"ns_per_op\": {:.3f}, \"entities_per_second\": {:.1f}, \"allocations_per_op\": {:.4f}",
+                result.name, result.ops, result.nsPerOp, result.opsPerSecond, result.allocationsPerOp
+            );
+
+            if (result.bytesPerOp) {
+                std::print(file, ", \"bytes_per_op\": {:.1f}", *result.bytesPerOp);
+            }
+
+            std::println(file, "}}{}", i + 1 < this->_results.size() ? "," : "");
+        }
+
+        std::println(file, "  ]");
+        std::println(file, "}}");
+        std::fclose(file);
+
+        return true;
+    }
+
+    std::size_t entities() const {
+        return this->_options.entities;
+    }
+
+private:
+    Options _options;
+    std::vector<Result> _results;
+};
+
+template<std::size_t... Is>
+void registerData(World& world, std::index_sequence<Is...>) {
+    (world.registerComponent<Data<Is>>(), ...);
+}
+
+template<std::size_t... Is>
+void registerFragments(World& world, std::index_sequence<Is...>) {
+    (world.registerComponent<Fragment<Is>>(), ...);
+}
+
+/// Creates a world with every benchmark component registered, data components first.
+std::unique_ptr<World> makeWorld(ArchetypeStorage storage = ArchetypeStorage::Contiguous) {
+    auto world = std::make_unique<World>();
+
+    registerData(*world, std::make_index_sequence<dataCount>{});
+    registerFragments(*world, std::make_index_sequence<fragmentCount>{});
+    world->registerComponent<SparseFlag>(StorageType::Sparse);
+    world->registerComponent<Marker>();
+    world->archetypes.setDefaultStorage(storage);
+
+    return world;
+}
+
+template<std::size_t... Is>
+Entity spawnData(World& world, std::index_sequence<Is...>) {
+    return world.spawn(Data<Is>{float(Is)}...);
+}
+
+/// Adds the fragments whose bits are set in the mask.
+template<std::size_t... Is>
+void insertFragments(World& world, Entity entity, std::size_t mask, std::index_sequence<Is...>) {
+    (..., (mask & (std::size_t(1) << Is) ? world.insert(entity, Fragment<Is>{int(Is)}) : void()));
+}
+
+/// Spawns entities holding every data component, spread over `1 << fragments` archetypes.
+std::unique_ptr<World> makeDataWorld(std::size_t count, std::size_t fragments, ArchetypeStorage storage) {
+    auto world = makeWorld(storage);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto entity = spawnData(*world, std::make_index_sequence<dataCount>{});
+        insertFragments(*world, entity, i & ((std::size_t(1) << fragments) - 1), std::make_index_sequence<fragmentCount>{});
+    }
+
+    return world;
+}
+
+template<std::size_t... Is>
+void iterData(World& world, std::index_sequence<Is...>) {
+    world.iter<Data<Is>...>([](Data<Is>&... data) {
+        ((data.value += 1.0f), ...);
+    });
+}
+
+template<std::size_t... Is>
+void benchIter(Bench& bench, const std::string& prefix, World& world, std::index_sequence<Is...>) {
+    (..., bench.measure(prefix + std::to_string(Is + 1), bench.entities(), [&]() { return &world; }, [](World* world) {
+        iterData(*world, std::make_index_sequence<Is + 1>{});
+    }));
+}
+
+struct SpawnedWorld {
+    std::unique_ptr<World> world;
+    std::vector<Entity> entities;
+};
+
+/// Creates a world with `count` entities of the given components.
+template<typename... Comps>
+SpawnedWorld makeSpawnedWorld(std::size_t count) {
+    auto state = SpawnedWorld{ makeWorld(), {} };
+    state.entities.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        state.entities.push_back(state.world->spawn(Comps{}...));
+    }
+
+    return state;
+}
+
+void benchStructural(Bench& bench) {
+    const auto count = bench.entities();
+
+    bench.measure("spawn", count, [&]() { return makeWorld(); }, [&](std::unique_ptr<World>& world) {
+        for (std::size_t i = 0; i < count; ++i) {
+            world->spawn(Data<0>{1.0f}, Data<1>{2.0f});
+        }
+    });
+
+    // Spawns through the FFI from a caller buffer holding both components back to back.
+    bench.measure("spawn_buffer", count, [&]() { return makeWorld(); }, [&](std::unique_ptr<World>& world) {
+        auto bitmask = Signature::of(world->getComponentId<Data<0>>()) | Signature::of(world->getComponentId<Data<1>>());
+        Data<0> buffer[2] = { {1.0f}, {2.0f} };
+
+        for (std::size_t i = 0; i < count; ++i) {
+            _WorldSpawnBuffer(world.get(), &bitmask, reinterpret_cast<std::byte*>(buffer));
+        }
+    });
+
+    struct BatchState {
+        std::unique_ptr<World> world;
+        std::vector<Data<0>> first;
+        std::vector<Data<1>> second;
+    };
+
+    bench.measure("spawn_batch", count, [&]() {
+        return BatchState{ makeWorld(), std::vector<Data<0>>(count, {1.0f}), std::vector<Data<1>>(count, {2.0f}) };
+    }, [](BatchState& state) {
+        auto entities = state.world->spawnBatch<Data<0>, Data<1>>(
+            std::span<const Data<0>>(state.first),
+            std::span<const Data<1>>(state.second)
+        );
+        sink = float(entities.size());
+    });
+
+    bench.measure("insert", count, [&]() { return makeSpawnedWorld<Data<0>>(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->insert(entity, Data<1>{1.0f});
+        }
+    });
+
+    bench.measure("remove", count, [&]() { return makeSpawnedWorld<Data<0>, Data<1>>(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->remove<Data<1>>(entity);
+        }
+    });
+
+    // Toggling a flag moves the whole row when the flag is a table component, and only touches the flag's
+    // set when it is sparse. A tag still moves the row, but has no column of its own.
+    using Row = SpawnedWorld (*)(std::size_t);
+    Row makeRow = &makeSpawnedWorld<Data<0>, Data<1>, Data<2>, Data<3>>;
+
+    bench.measure("toggle_table", count, [&]() { return makeRow(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->insert(entity, Fragment<0>{1});
+            state.world->remove<Fragment<0>>(entity);
+        }
+    });
+
+    bench.measure("toggle_tag", count, [&]() { return makeRow(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->insert(entity, Marker{});
+            state.world->remove<Marker>(entity);
+        }
+    });
+
+    bench.measure("toggle_sparse", count, [&]() { return makeRow(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->insert(entity, SparseFlag{1});
+            state.world->remove<SparseFlag>(entity);
+        }
+    });
+
+    bench.measure("despawn", count, [&]() { return makeSpawnedWorld<Data<0>, Data<1>>(count); }, [](SpawnedWorld& state) {
+        for (auto entity : state.entities) {
+            state.world->despawn(entity);
+        }
+    });
+
+    // Shuffled, so lookups don't walk the columns in order.
+    auto lookup = makeSpawnedWorld<Data<0>, Data<1>, Data<2>, Data<3>>(count);
+    std::shuffle(lookup.entities.begin(), lookup.entities.end(), std::mt19937(42));
+
+    bench.measure("get", count, [&]() { return &lookup; }, [](SpawnedWorld* state) {
+        float sum = 0.0f;
+
+        for (auto entity : state->entities) {
+            sum += state->world->get<Data<2>>(entity)->value;
+        }
+
+        sink = sum;
+    });
+}
+
+void benchIteration(Bench& bench) {
+    const auto count = bench.entities();
+
+    auto dense = makeDataWorld(count, 0, ArchetypeStorage::Contiguous);
+    benchIter(bench, "iter_dense_", *dense, std::make_index_sequence<dataCount>{});
+    dense.reset();
+
+    auto fragmented = makeDataWorld(count, 5, ArchetypeStorage::Contiguous);
+    benchIter(bench, "iter_fragmented_", *fragmented, std::make_index_sequence<dataCount>{});
+    fragmented.reset();
+
+    auto chunked = makeDataWorld(count, 0, ArchetypeStorage::Chunked);
+    benchIter(bench, "iter_chunked_", *chunked, std::make_index_sequence<dataCount>{});
+}
+
+void benchQuery(Bench& bench) {
+    const auto count = bench.entities();
+
+    // Every combination of fragments, so fetching has to test 1024 archetypes.
+    auto world = makeWorld();
+    auto archetypeCount = std::size_t(1) << fragmentCount;
+
+    for (std::size_t i = 0; i < archetypeCount; ++i) {
+        auto entity = world->spawn(Data<0>{1.0f});
+        insertFragments(*world, entity, i, std::make_index_sequence<fragmentCount>{});
+    }
+
+    auto fetchBitmask = Signature::of(world->getComponentId<Data<0>>());
+    const std::size_t fetches = 1000;
+
+    bench.measure("query_fetch_cold", fetches, [&]() { return world.get(); }, [&](World* world) {
+        for (std::size_t i = 0; i < fetches; ++i) {
+            Query query;
+            query.fetch(&world->archetypes, fetchBitmask);
+            sink = float(query.chunks.size());
+        }
+    });
+
+    Query cached;
+    cached.fetch(&world->archetypes, fetchBitmask);
+
+    bench.measure("query_fetch_cached", fetches, [&]() { return world.get(); }, [&](World* world) {
+        for (std::size_t i = 0; i < fetches; ++i) {
+            cached.fetch(&world->archetypes, fetchBitmask);
+        }
+
+        sink = float(cached.chunks.size());
+    });
+
+    world.reset();
+
+    // Same walk a foreign caller does: fetch through the C ABI, then read the raw chunks.
+    auto ffiWorld = makeDataWorld(count, 5, ArchetypeStorage::Contiguous);
+    auto ffiBitmask = Signature::of(ffiWorld->getComponentId<Data<0>>());
+    auto ffiQuery = _QueryCreate();
+
+    bench.measure("ffi_query_iter", count, [&]() { return ffiWorld.get(); }, [&](World* world) {
+        FfiQueryChunk* chunks = nullptr;
+        auto chunkCount = _QueryIter(world, &ffiBitmask, ffiQuery, &chunks);
+        float sum = 0.0f;
+
+        for (int i = 0; i < chunkCount; ++i) {
+            auto values = reinterpret_cast<const Data<0>*>(chunks[i].columns[0].data);
+
+            for (std::size_t row = 0; row < chunks[i].entityCount; ++row) {
+                sum += values[row].value;
+            }
+        }
+
+        sink = sum;
+    });
+
+    _QueryDestroy(ffiQuery);
+}
+
+/// Adds velocity times the time step to position. Positions and velocities are plain float triples, so a
+/// chunk of them is one flat array. Blocks of `lanes` rows have a fixed trip count the compiler turns into
+/// SIMD instructions, and the remainder rows are handled one by one.
+static void integrateKernel(const QueryChunkInfo& info, float* __restrict position, const float* __restrict velocity) {
+    constexpr std::size_t lanes = 8;
+    constexpr std::size_t floats = 3;
+
+    for (std::size_t row = 0; row < info.body(lanes); row += lanes) {
+        for (std::size_t i = 0; i < lanes * floats; ++i) {
+            position[row * floats + i] += velocity[row * floats + i] * deltaTime;
+        }
+    }
+
+    for (std::size_t i = info.body(lanes) * floats; i < info.length * floats; ++i) {
+        position[i] += velocity[i] * deltaTime;
+    }
+}
+
+/// Sums values in blocks of `lanes` independent accumulators, which is what a SIMD register holds, and
+/// adds the remainder rows one by one.
+static float sumKernel(const QueryChunkInfo& info, std::span<const Data<0>> values) {
+    constexpr std::size_t lanes = 8;
+    float lane[lanes] = {};
+
+    for (std::size_t row = 0; row < info.body(lanes); row += lanes) {
+        for (std::size_t i = 0; i < lanes; ++i) {
+            lane[i] += values[row + i].value;
+        }
+    }
+
+    for (std::size_t row = info.body(lanes); row < info.length; ++row) {
+        lane[0] += values[row].value;
+    }
+
+    return std::accumulate(std::begin(lane), std::end(lane), 0.0f);
+}
+
+/// Compares reference kernels fed whole chunks by World::iterChunks against the same work done per entity,
+/// both with an inlined lambda and through a call the compiler can't inline.
+void benchKernels(Bench& bench) {
+    const auto count = bench.entities();
+
+    auto world = makeWorld();
+    world->registerComponent<Position>();
+    world->registerComponent<Velocity>();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        world->spawn(Position{0.0f, 0.0f, 0.0f}, Velocity{1.0f, 2.0f, 3.0f}, Data<0>{float(i % 7)});
+    }
+
+    bench.measure("kernel_integrate_entity", count, [&]() { return world.get(); }, [](World* world) {
+        world->iter<Position, const Velocity>([](Position& position, const Velocity& velocity) {
+            position.x += velocity.x * deltaTime;
+            position.y += velocity.y * deltaTime;
+            position.z += velocity.z * deltaTime;
+        });
+    });
+
+    std::function<void(Position&, const Velocity&)> integrate = [](Position& position, const Velocity& velocity) {
+        position.x += velocity.x * deltaTime;
+        position.y += velocity.y * deltaTime;
+        position.z += velocity.z * deltaTime;
+    };
+
+    bench.measure("kernel_integrate_dispatch", count, [&]() { return world.get(); }, [&](World* world) {
+        world->iter<Position, const Velocity>(integrate);
+    });
+
+    bench.measure("kernel_integrate_chunk", count, [&]() { return world.get(); }, [](World* world) {
+        world->iterChunks<Position, const Velocity>([](const QueryChunkInfo& info, std::span<Position> positions, std::span<const Velocity> velocities) {
+            integrateKernel(info, &positions.data()->x, &velocities.data()->x);
+        });
+    });
+
+    bench.measure("kernel_sum_entity", count, [&]() { return world.get(); }, [](World* world) {
+        float sum = 0.0f;
+
+        world->iter<const Data<0>>([&](const Data<0>& value) {
+            sum += value.value;
+        });
+
+        sink = sum;
+    });
+
+    bench.measure("kernel_sum_chunk", count, [&]() { return world.get(); }, [](World* world) {
+        float sum = 0.0f;
+
+        world->iterChunks<const Data<0>>([&](const QueryChunkInfo& info, std::span<const Data<0>> values) {
+            sum += sumKernel(info, values);
+        });
+
+        sink = sum;
+    });
+}
+
+/// World replicated to a mirror through deltas, with one tick of churn waiting to be encoded.
+struct ReplicatedWorld {
+    std::unique_ptr<World> world;
+    std::unique_ptr<World> mirror;
+    std::vector<Entity> entities;
+    DeltaEncoder encoder;
+    std::vector<std::byte> delta;
+};
+
+/// Creates `count` moving entities, replicates them once, then churns a tick: 5% of the entities are
+/// despawned and replaced by new ones, and another 5% move.
+ReplicatedWorld makeReplicatedWorld(std::size_t count) {
+    auto state = ReplicatedWorld{ makeWorld(), makeWorld(), {}, {}, {} };
+    state.world->registerComponent<Position>();
+    state.world->registerComponent<Velocity>();
+    state.mirror->registerComponent<Position>();
+    state.mirror->registerComponent<Velocity>();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        state.entities.push_back(state.world->spawn(Position{0.0f, 0.0f, 0.0f}, Velocity{1.0f, 2.0f, 3.0f}));
+    }
+
+    state.encoder.encode(*state.world, state.delta);
+    applyDelta(*state.mirror, state.delta);
+    state.delta.clear();
+
+    std::mt19937 random(42);
+    std::shuffle(state.entities.begin(), state.entities.end(), random);
+
+    auto churn = count / 20;
+    for (std::size_t i = 0; i < churn; ++i) {
+        state.world->despawn(state.entities[i]);
+        state.entities[i] = state.world->spawn(Position{0.0f, 0.0f, 0.0f}, Velocity{1.0f, 2.0f, 3.0f});
+    }
+
+    for (std::size_t i = churn; i < 2 * churn; ++i) {
+        state.world->get<Position>(state.entities[i])->x += 1.0f;
+    }
+
+    return state;
+}
+
+void benchDelta(Bench& bench) {
+    const auto count = bench.entities();
+
+    // One operation is a whole tick, so ns/op is the time per tick and bytes/op the size of its delta.
+    bench.measure("delta_encode_tick", 1, [&]() { return makeReplicatedWorld(count); }, [](ReplicatedWorld& state) {
+        state.encoder.encode(*state.world, state.delta);
+        return state.delta.size();
+    });
+
+    bench.measure("delta_apply_tick", 1, [&]() {
+        auto state = makeReplicatedWorld(count);
+        state.encoder.encode(*state.world, state.delta);
+        return state;
+    }, [](ReplicatedWorld& state) {
+        applyDelta(*state.mirror, state.delta);
+    });
+}
+
+struct ViewedWorld {
+    std::unique_ptr<World> world;
+    WorldView view;
+};
+
+/// Creates `count` moving entities in chunked storage and takes a view of them, then moves 1% of them.
+ViewedWorld makeViewedWorld(std::size_t count) {
+    auto state = ViewedWorld{ makeWorld(ArchetypeStorage::Chunked), {} };
+    state.world->registerComponent<Position>();
+    state.world->registerComponent<Velocity>();
+
+    std::vector<Entity> entities;
+    for (std::size_t i = 0; i < count; ++i) {
+        entities.push_back(state.world->spawn(Position{0.0f, 0.0f, 0.0f}, Velocity{1.0f, 2.0f, 3.0f}));
+    }
+
+    state.view = state.world->view<Position, Velocity>();
+
+    std::mt19937 random(42);
+    std::shuffle(entities.begin(), entities.end(), random);
+
+    for (std::size_t i = 0; i < count / 100; ++i) {
+        state.world->get<Position>(entities[i])->x += 1.0f;
+    }
+
+    return state;
+}
+
+void benchView(Bench& bench) {
+    const auto count = bench.entities();
+
+    // One operation is a whole tick, bytes/op are the bytes copied instead of shared with the previous view.
+    bench.measure("view_capture_tick", 1, [&]() { return makeViewedWorld(count); }, [](ViewedWorld& state) {
+        auto view = state.world->view<Position, Velocity>(&state.view);
+        return view.copiedBytes();
+    });
+}
+
+int main(int argc, char** argv) {
+    auto options = Options{};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--entities") == 0) {
+            options.entities = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            options.samples = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--out") == 0) {
+            options.output = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            options.filter = argv[i + 1];
+        } else {
+            std::println("Usage: {} [--entities n] [--samples n] [--out file] [--filter name]", argv[0]);
+            return 1;
+        }
+    }
+
+    auto bench = Bench(options);
+
+    benchStructural(bench);
+    benchIteration(bench);
+    benchKernels(bench);
+    benchQuery(bench);
+    benchDelta(bench);
+    benchView(bench);
+
+    if (!bench.write()) {
+        std::println("Failed to write {}", options.output);
+        return 1;
+    }
+
+    return 0;
+}
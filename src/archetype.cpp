@@ -1,72 +1,240 @@
 #include "archetype.hpp"
 #include "blob_vector.hpp"
 
+#include <algorithm>
 #include <bit>
 #include <cassert>
+#include <new>
 #include <print>
-#include <unordered_map>
 
-Archetype::Archetype(component_id bitmask, std::shared_ptr<Components> components)  {
+void ChunkDeleter::operator()(std::byte* block) const {
+    if (!this->owned) {
+        return;
+    }
+
+    operator delete(block, std::align_val_t{Archetype::chunkAlign});
+}
+
+Archetype::Archetype(const Signature& bitmask, std::shared_ptr<Components> components, ArchetypeStorage storage)  {
     this->_bitmask = bitmask;
     this->_components = components;
-    this->_columns.reserve(std::popcount(bitmask));
+    this->_columns.reserve(bitmask.count());
+
+    // Tags only live in the bitmask, so rows never do any work for them.
+    (bitmask & ~this->_components->tags()).forEach([&](component_id id) {
+        assert(this->_components->isRegistered(id));
+
+        auto typeInfo = this->_components->getTypeInfo(id);
+        this->addColumn(id, std::move(typeInfo));
+    });
 
-    while (bitmask != 0) {
-        auto index = std::countr_zero(bitmask);
-        auto bit = component_id(1) << index;
+    if (storage != ArchetypeStorage::Contiguous) {
+        this->setStorage(storage);
+    }
+}
+
+void Archetype::push(component_id id, std::byte* bytes, Tick tick) {
+    auto column = this->getColumn(id);
+    assert(column != nullptr);
 
-        if ((bitmask & bit) != 0) {
-            assert(this->_components->isRegistered(bit));
+    this->ensureChunks(column->length() + 1);
+    column->push(bytes, tick);
+}
+
+ArchetypeEdge& ArchetypeEdges::get(const Signature& bitmask) {
+    if (bitmask.count() == 1) {
+        auto index = std::size_t(bitmask.first());
 
-            auto typeInfo = this->_components->getTypeInfo(bit);
-            this->addColumn(bit, std::move(typeInfo));
+        if (index >= this->components.size()) {
+            this->components.resize(index + 1);
         }
 
-        bitmask ^= bit;
+        return this->components[index];
     }
+
+    return this->getBundle(bitmask);
 }
 
-void Archetype::push(component_id bit, std::byte* bytes) {
-    assert(this->_columnMap.contains(bit));
+ArchetypeEdge& ArchetypeEdges::getBundle(const Signature& bitmask) {
+    for (auto& [mask, edge] : this->bundles) {
+        if (mask == bitmask) {
+            return edge;
+        }
+    }
 
-    auto position = this->_columnMap[bit];
-    this->_columns[position].push(bytes);
+    return this->bundles.emplace_back(bitmask, ArchetypeEdge{}).second;
 }
 
-void Archetype::moveData(std::size_t row, Archetype* to) {
-    auto last = this->length() - 1;
-
-    for (const auto& [bit, pos] : this->_columnMap) {
-        auto& src = this->_columns[pos];
+void Archetype::moveData(std::size_t row, Archetype* to, const std::vector<std::size_t>& columnMapping) {
+    assert(columnMapping.size() == this->_columns.size());
 
-        if ((to->bitmask() & bit) != 0) {
-            auto dst = to->getColumn(bit);
-            assert(dst != nullptr);
+    for (std::size_t i = 0; i < this->_columns.size(); ++i) {
+        auto& src = this->_columns[i];
+        auto target = columnMapping[i];
 
+        if (target != ArchetypeEdge::npos) {
+            auto dst = to->columnAt(target);
             dst->set(dst->length() - 1, src.get(row));
+            dst->setTicks(dst->length() - 1, src.ticks(row));
         } else {
             src.typeInfo().destructor(src.get(row));
         }
+
+        src.removeUninitialized(row);
     }
+}
 
-    if (row != last) {
-        for (auto& column : this->_columns) {
-            column.typeInfo().destructor(column.swapRemove(row));
+void Archetype::addColumn(component_id id, TypeInfo typeInfo) {
+    if (id >= this->_columnIndices.size()) {
+        this->_columnIndices.resize(id + 1, noColumn);
+    }
+
+    this->_columnIndices[id] = std::uint16_t(this->_columns.size());
+    this->_columns.emplace_back<BlobVector>(std::move(typeInfo));
+}
+
+void Archetype::grow(Entity entity, Tick tick) {
+    this->_entities.push_back(std::move(entity));
+    this->ensureChunks(this->_entities.size());
+
+    for (auto& column : this->_columns) {
+        column.grow(1, tick);
+    }
+}
+
+void Archetype::growBatch(const Entity* entities, std::size_t count, Tick tick) {
+    this->_entities.insert(this->_entities.end(), entities, entities + count);
+    this->ensureChunks(this->_entities.size());
+
+    for (auto& column : this->_columns) {
+        column.grow(count, tick);
+    }
+}
+
+void Archetype::reserve(std::size_t additional) {
+    this->_entities.reserve(this->_entities.size() + additional);
+
+    if (this->_storage == ArchetypeStorage::Chunked) {
+        this->ensureChunks(this->_entities.size() + additional);
+        return;
+    }
+
+    for (auto& column : this->_columns) {
+        column.reserve(column.length() + additional);
+    }
+}
+
+void Archetype::removeRow(std::size_t row) {
+    for (auto& column : this->_columns) {
+        column.typeInfo().destructor(column.get(row));
+        column.removeUninitialized(row);
+    }
+}
+
+void Archetype::moveAll(Archetype* to, const std::vector<std::size_t>& columnMapping, Tick tick) {
+    assert(columnMapping.size() == this->_columns.size());
+
+    auto count = this->length();
+    std::vector<bool> filled(to->_columns.size(), false);
+
+    to->ensureChunks(to->length() + count);
+
+    for (std::size_t i = 0; i < this->_columns.size(); ++i) {
+        auto target = columnMapping[i];
+
+        if (target != ArchetypeEdge::npos) {
+            to->_columns[target].append(this->_columns[i]);
+            filled[target] = true;
+        } else {
+            this->_columns[i].clear();
+        }
+    }
+
+    for (std::size_t i = 0; i < to->_columns.size(); ++i) {
+        if (!filled[i]) {
+            to->_columns[i].grow(count, tick);
         }
     }
 
+    if (to->_entities.empty()) {
+        std::swap(to->_entities, this->_entities);
+    } else {
+        to->_entities.insert(to->_entities.end(), this->_entities.begin(), this->_entities.end());
+    }
+
+    this->_entities.clear();
 }
 
-void Archetype::addColumn(component_id bit, TypeInfo typeInfo) {
-    this->_columnMap[bit] = this->_columns.size();
-    this->_columns.emplace_back<BlobVector>(std::move(typeInfo));
+void Archetype::clear() {
+    for (auto& column : this->_columns) {
+        column.clear();
+    }
+
+    this->_entities.clear();
 }
 
-void Archetype::grow(Entity entity) {
-    this->_entities.push_back(std::move(entity));
+void Archetype::setStorage(ArchetypeStorage storage) {
+    assert(this->length() == 0);
+
+    for (auto& column : this->_columns) {
+        column = BlobVector(column.typeInfo());
+    }
+
+    this->_storage = storage;
+    this->_chunks.clear();
+    this->_adopted.reset();
+    this->_chunkOffsets.clear();
+    this->_chunkRows = 0;
+    this->_chunkBytes = 0;
+
+    if (storage == ArchetypeStorage::Contiguous) {
+        return;
+    }
+
+    // Lays out `rows` rows column after column, every column starting on its own cache line.
+    auto layout = [&](std::size_t rows) {
+        std::size_t offset = 0;
+        this->_chunkOffsets.clear();
+
+        for (auto& column : this->_columns) {
+            offset = (offset + chunkAlign - 1) / chunkAlign * chunkAlign;
+            this->_chunkOffsets.push_back(offset);
+            offset += rows * column.typeInfo().size;
+        }
+
+        return (offset + chunkAlign - 1) / chunkAlign * chunkAlign;
+    };
 
+    std::size_t rowSize = 0;
     for (auto& column : this->_columns) {
-        column.grow(1);
+        rowSize += column.typeInfo().size;
+    }
+
+    auto rows = std::max<std::size_t>(1, chunkSize / std::max<std::size_t>(1, rowSize));
+    while (rows > 1 && layout(rows) > chunkSize) {
+        --rows;
+    }
+
+    this->_chunkRows = rows;
+    this->_chunkBytes = layout(rows);
+
+    for (auto& column : this->_columns) {
+        column.usePages(rows);
+    }
+}
+
+void Archetype::ensureChunks(std::size_t rows) {
+    if (this->_storage != ArchetypeStorage::Chunked || this->_columns.empty()) {
+        return;
+    }
+
+    while (this->_chunks.size() * this->_chunkRows < rows) {
+        auto block = static_cast<std::byte*>(operator new(this->_chunkBytes, std::align_val_t{chunkAlign}));
+        this->_chunks.emplace_back(block);
+
+        for (std::size_t i = 0; i < this->_columns.size(); ++i) {
+            this->_columns[i].addPage(block + this->_chunkOffsets[i]);
+        }
     }
 }
 
@@ -92,44 +260,111 @@ Entity Archetype::getEntity(std::size_t row) {
     return this->_entities[row];
 }
 
-BlobVector* Archetype::getColumn(component_id bit) {
-    if (!this->_columnMap.contains(bit)) {
-        return nullptr;
-    }
+BlobVector* Archetype::columnAt(std::size_t index) {
+    assert(index < this->_columns.size());
 
-    return &this->_columns[this->_columnMap[bit]];
+    return &this->_columns[index];
+}
+
+std::size_t Archetype::columnCount() const {
+    return this->_columns.size();
 }
 
 std::size_t Archetype::length() const {
     return this->_entities.size();
 }
 
-component_id Archetype::bitmask() const {
+const Signature& Archetype::bitmask() const {
     return this->_bitmask;
 }
 
+ArchetypeStorage Archetype::storage() const {
+    return this->_storage;
+}
+
+std::size_t Archetype::chunkRows() const {
+    if (this->_storage == ArchetypeStorage::Contiguous) {
+        return this->length();
+    }
+
+    return this->_chunkRows;
+}
+
+std::size_t Archetype::chunkCount() const {
+    if (this->_storage == ArchetypeStorage::Contiguous) {
+        return 1;
+    }
+
+    return (this->length() + this->_chunkRows - 1) / this->_chunkRows;
+}
+
+std::byte* Archetype::block(std::size_t index) {
+    assert(index < this->_chunks.size());
+
+    return this->_chunks[index].get();
+}
+
+std::size_t Archetype::blockBytes() const {
+    return this->_chunkBytes;
+}
+
+void Archetype::adoptBlocks(std::byte* blocks, std::size_t count, std::shared_ptr<const void> owner) {
+    assert(this->_storage == ArchetypeStorage::Chunked && this->_chunks.empty());
+    assert(reinterpret_cast<std::uintptr_t>(blocks) % chunkAlign == 0);
+
+    if (this->_columns.empty()) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto block = blocks + i * this->_chunkBytes;
+        this->_chunks.emplace_back(block, ChunkDeleter{.owned = false});
+
+        for (std::size_t j = 0; j < this->_columns.size(); ++j) {
+            this->_columns[j].addPage(block + this->_chunkOffsets[j]);
+        }
+    }
+
+    this->_adopted = std::move(owner);
+}
+
+ArchetypeEdges& Archetype::insertEdges() {
+    return this->_insertEdges;
+}
+
+ArchetypeEdges& Archetype::removeEdges() {
+    return this->_removeEdges;
+}
+
+ArchetypeEdges& Archetype::moveEdges() {
+    return this->_moveEdges;
+}
+
 
 Archetypes::Archetypes(std::shared_ptr<Components> components) {
     this->_components = components;
+    this->add(Signature{}, Archetype(Signature{}, this->_components));
 }
 
-void Archetypes::add(component_id bitmask, Archetype&& archetype) {
+void Archetypes::add(const Signature& bitmask, Archetype&& archetype) {
     this->_archetypeMap[bitmask] = this->_archetypes.size();
     this->_archetypes.emplace_back(std::move(archetype));
 }
 
-void Archetypes::moveEntity(Entity entity, component_id from, component_id to, Entities* entities){
-    auto toIndex = this->_archetypeMap[to];
+void Archetypes::moveEntity(Entity entity, const ArchetypeEdge& edge, Entities* entities, Tick tick) {
+    assert(edge.target != ArchetypeEdge::npos);
 
-    auto fromArchetype = this->get(from);
-    auto toArchetype = this->get(to);
+    auto oldLocation = entities->getLocation(entity).value();
+    auto toIndex = edge.target;
 
-    toArchetype->grow(std::move(entity));
+    auto fromArchetype = this->at(oldLocation.archetype);
+    auto toArchetype = this->at(toIndex);
+
+    toArchetype->grow(entity, tick);
 
-    auto oldLocation = entities->getLocation(entity).value();
     auto lastIndex = fromArchetype->length() - 1;
 
-    fromArchetype->moveData(oldLocation.row, toArchetype);
+    fromArchetype->moveData(oldLocation.row, toArchetype, edge.columnMapping);
 
     if (oldLocation.row != lastIndex) {
         auto lastEntity = fromArchetype->getEntity(lastIndex);
@@ -144,21 +379,173 @@ void Archetypes::moveEntity(Entity entity, component_id from, component_id to, E
     entities->setLocation(entity, EntityLocation {toIndex, newRow});
 }
 
-Archetype* Archetypes::getOrCreate(component_id bit) {
-    if (!this->_archetypeMap.contains(bit)) {
-        auto archetype = Archetype(bit, this->_components);
-        this->add(bit, std::move(archetype));
+void Archetypes::removeEntity(Entity entity, Entities* entities) {
+    auto location = entities->getLocation(entity).value();
+    auto archetype = this->at(location.archetype);
+    auto lastIndex = archetype->length() - 1;
+
+    archetype->removeRow(location.row);
+
+    if (location.row != lastIndex) {
+        auto lastEntity = archetype->getEntity(lastIndex);
+        archetype->setEntity(location.row, lastEntity);
+
+        entities->setLocation(lastEntity, location);
+    }
+
+    archetype->popEntity();
+    entities->clearLocation(entity);
+}
+
+void Archetypes::removeRows(std::size_t index, const std::vector<std::size_t>& rows, Entities* entities) {
+    auto archetype = this->at(index);
+
+    for (std::size_t i = 0; i < archetype->columnCount(); ++i) {
+        auto& column = *archetype->columnAt(i);
+
+        for (auto row : rows) {
+            column.typeInfo().destructor(column.get(row));
+            column.removeUninitialized(row);
+        }
+    }
+
+    for (auto row : rows) {
+        auto lastIndex = archetype->length() - 1;
+        entities->clearLocation(archetype->getEntity(row));
+
+        if (row != lastIndex) {
+            auto lastEntity = archetype->getEntity(lastIndex);
+            archetype->setEntity(row, lastEntity);
+
+            entities->setLocation(lastEntity, EntityLocation{index, row});
+        }
+
+        archetype->popEntity();
+    }
+}
+
+std::size_t Archetypes::moveAll(std::size_t from, const ArchetypeEdge& edge, Entities* entities, Tick tick) {
+    auto source = this->at(from);
+    auto target = this->at(edge.target);
+    auto row = target->length();
+
+    source->moveAll(target, edge.columnMapping, tick);
+
+    for (auto i = row; i < target->length(); ++i) {
+        entities->setLocation(target->getEntity(i), EntityLocation{edge.target, i});
+    }
+
+    return row;
+}
+
+const ArchetypeEdge& Archetypes::insertEdge(std::size_t from, const Signature& bitmask) {
+    auto& edge = this->at(from)->insertEdges().get(bitmask);
+
+    if (edge.target == ArchetypeEdge::npos) {
+        this->resolveEdge(edge, from, this->at(from)->bitmask() | bitmask, bitmask);
+    }
+
+    return edge;
+}
+
+const ArchetypeEdge& Archetypes::removeEdge(std::size_t from, const Signature& bitmask) {
+    auto& edge = this->at(from)->removeEdges().get(bitmask);
+
+    if (edge.target == ArchetypeEdge::npos) {
+        this->resolveEdge(edge, from, this->at(from)->bitmask() & ~bitmask, Signature{});
+    }
+
+    return edge;
+}
+
+const ArchetypeEdge& Archetypes::transitionEdge(std::size_t from, const Signature& target) {
+    const auto& source = this->at(from)->bitmask();
+
+    if (target.contains(source)) {
+        return this->insertEdge(from, target & ~source);
+    }
+
+    if (source.contains(target)) {
+        return this->removeEdge(from, source & ~target);
+    }
+
+    auto& edge = this->at(from)->moveEdges().getBundle(target);
+
+    if (edge.target == ArchetypeEdge::npos) {
+        this->resolveEdge(edge, from, target, target & ~source);
+    }
+
+    return edge;
+}
+
+void Archetypes::resolveEdge(ArchetypeEdge& edge, std::size_t from, const Signature& target, const Signature& bundle) {
+    // Archetypes live in a deque, so creating the target keeps the source and the edge in place.
+    auto toArchetype = this->getOrCreate(target);
+    auto fromArchetype = this->at(from);
+
+    const auto& tags = this->_components->tags();
+
+    edge.columnMapping.assign(fromArchetype->columnCount(), ArchetypeEdge::npos);
+
+    (fromArchetype->bitmask() & ~tags).forEach([&](component_id id) {
+        if (target.test(id)) {
+            edge.columnMapping[fromArchetype->columnIndex(id)] = toArchetype->columnIndex(id);
+        }
+    });
+
+    edge.bundleColumns.clear();
+
+    (bundle & ~tags).forEach([&](component_id id) {
+        edge.bundleColumns.push_back(toArchetype->columnIndex(id));
+    });
+
+    edge.target = this->position(target);
+}
+
+void Archetypes::setDefaultStorage(ArchetypeStorage storage) {
+    this->_defaultStorage = storage;
+}
+
+void Archetypes::addSparseSet(component_id id, TypeInfo typeInfo) {
+    if (id >= this->_sparseSets.size()) {
+        this->_sparseSets.resize(id + 1);
+    }
+
+    assert(!this->_sparseSets[id] && "Component already has a sparse set");
+
+    this->_sparseSets[id] = std::make_unique<SparseSet>(typeInfo);
+    this->_sparseMask.set(id);
+}
+
+const Signature& Archetypes::sparseMask() const {
+    return this->_sparseMask;
+}
+
+const Signature& Archetypes::tagMask() const {
+    return this->_components->tags();
+}
+
+void Archetypes::removeSparse(EntityId id) {
+    this->_sparseMask.forEach([&](component_id component) {
+        this->_sparseSets[component]->remove(id);
+    });
+}
+
+Archetype* Archetypes::getOrCreate(const Signature& bitmask) {
+    if (!this->_archetypeMap.contains(bitmask)) {
+        auto archetype = Archetype(bitmask, this->_components, this->_defaultStorage);
+        this->add(bitmask, std::move(archetype));
     }
 
-    return this->get(bit);
+    return this->get(bitmask);
 }
 
-Archetype* Archetypes::get(component_id bit) {
-    if (!this->_archetypeMap.contains(bit)) {
+Archetype* Archetypes::get(const Signature& bitmask) {
+    if (!this->_archetypeMap.contains(bitmask)) {
         return nullptr;
     }
 
-    return &this->_archetypes[this->_archetypeMap[bit]];
+    return &this->_archetypes[this->_archetypeMap[bitmask]];
 }
 
 
@@ -174,14 +561,14 @@ std::deque<Archetype>& Archetypes::archetypes() {
     return this->_archetypes;
 }
 
-std::size_t Archetypes::position(component_id bit) const {
-    assert(this->_archetypeMap.contains(bit));
+std::size_t Archetypes::position(const Signature& bitmask) const {
+    assert(this->_archetypeMap.contains(bitmask));
 
-    return this->_archetypeMap.at(bit);
+    return this->_archetypeMap.at(bitmask);
 }
 
-bool Archetypes::exists(component_id bit) const {
-    return this->_archetypeMap.contains(bit);
+bool Archetypes::exists(const Signature& bitmask) const {
+    return this->_archetypeMap.contains(bitmask);
 }
 
 std::size_t Archetypes::length() const {
@@ -3,50 +3,166 @@
 #include "blob_vector.hpp"
 #include "components.hpp"
 #include "entity.hpp"
+#include "signature.hpp"
+#include "sparse_set.hpp"
+#include "tick.hpp"
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <limits>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+/// Cached transition between two archetypes, created on the first insert or remove of a bundle.
+struct ArchetypeEdge {
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Index of the target archetype, `npos` until the edge is resolved.
+    std::size_t target = npos;
+    /// For every column of the source archetype, position of the same component's column in the target
+    /// archetype, or `npos` when the transition drops the component.
+    std::vector<std::size_t> columnMapping;
+    /// For every component of the transition's bitmask, in bit order, position of its column in the target.
+    /// Tags have no column and are left out.
+    std::vector<std::size_t> bundleColumns;
+};
+
+/// Insert or remove edges of a single archetype. Single component transitions are indexed directly by the
+/// component id, bundles of several components are looked up linearly.
+struct ArchetypeEdges {
+    std::vector<ArchetypeEdge> components;
+    std::vector<std::pair<Signature, ArchetypeEdge>> bundles;
+
+    /// Returns the edge for the given bitmask, which is unresolved when the transition was never taken.
+    ArchetypeEdge& get(const Signature& bitmask);
+
+    /// Returns the edge stored under the whole bitmask, skipping the per component index.
+    ArchetypeEdge& getBundle(const Signature& bitmask);
+};
+
+/// How an archetype lays out its columns. Contiguous columns are single buffers that double when full.
+/// Chunked columns live in fixed-size blocks shared by all columns of the archetype, each holding the same
+/// number of rows, so growth adds a block instead of relocating rows and queries see one chunk per block.
+enum class ArchetypeStorage : std::uint8_t {
+    Contiguous,
+    Chunked,
+};
+
+/// Frees a block allocated for chunked storage. Adopted blocks belong to someone else and are left alone.
+struct ChunkDeleter {
+    bool owned = true;
+
+    void operator()(std::byte* block) const;
+};
+
 class Archetype {
 public:
-    explicit Archetype(component_id bitmask, std::shared_ptr<Components> components);
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Target size of a block in chunked storage. Rows wider than a block get blocks of a single row.
+    static constexpr std::size_t chunkSize = 16 * 1024;
+    /// Alignment of every column start inside a block.
+    static constexpr std::size_t chunkAlign = BlobVector::bufferAlign;
+
+    explicit Archetype(
+        const Signature& bitmask,
+        std::shared_ptr<Components> components,
+        ArchetypeStorage storage = ArchetypeStorage::Contiguous
+    );
 
     template<typename T, typename... Args>
-    void emplace(Args&&... args) {
+    void emplace(Tick tick, Args&&... args) {
         assert(this->_components->isRegistered<T>());
 
-        auto bit = this->_components->getId<T>();
-        assert(this->_columnMap.contains(bit));
+        auto column = this->getColumn(this->_components->getId<T>());
+        assert(column != nullptr);
 
-        this->_columns[this->_columnMap[bit]].template emplace<T>(std::forward<Args>(args)...);
+        this->ensureChunks(column->length() + 1);
+        column->template emplace<T>(tick, std::forward<Args>(args)...);
     }
 
-    void push(component_id bit, std::byte* bytes);
+    void push(component_id id, std::byte* bytes, Tick tick);
 
     template<TriviallyCopyable T>
-    void push(T&& value) {
+    void push(T&& value, Tick tick) {
         assert(this->_components->isRegistered<T>());
 
-        auto bit = this->_components->getId<T>();
-        this->push(bit, reinterpret_cast<std::byte*>(&value));
+        auto id = this->_components->getId<T>();
+        this->push(id, reinterpret_cast<std::byte*>(&value), tick);
     }
 
-    void moveData(std::size_t row, Archetype* to);
-    void addColumn(component_id bit, TypeInfo typeInfo);
-    void grow(Entity entity);
-    void setEntity(component_id row, Entity entity);
+    /// Moves the row into the last row of `to`, dropping columns that `to` doesn't have, and fills the gap
+    /// with the last row. The mapping comes from the edge between both archetypes. Moved components keep
+    /// their ticks.
+    void moveData(std::size_t row, Archetype* to, const std::vector<std::size_t>& columnMapping);
+    void addColumn(component_id id, TypeInfo typeInfo);
+    /// Appends the entity and grows every column by an uninitialized row added at the tick.
+    void grow(Entity entity, Tick tick);
+    /// Appends the entities and grows every column by their count, leaving new rows uninitialized.
+    void growBatch(const Entity* entities, std::size_t count, Tick tick);
+    /// Reserves room for the given number of additional rows in every column.
+    void reserve(std::size_t additional);
+    /// Destroys every component of the row and fills the gap with the last row. The entity array is
+    /// left untouched.
+    void removeRow(std::size_t row);
+    /// Moves every row to the end of `to`, leaving this archetype empty. Columns dropped by the mapping are
+    /// destroyed, columns only `to` has are grown by rows added at the tick and left uninitialized. When
+    /// `to` is empty, column buffers are handed over without copying.
+    void moveAll(Archetype* to, const std::vector<std::size_t>& columnMapping, Tick tick);
+    /// Destroys every row.
+    void clear();
+    /// Switches the layout of the archetype's columns, which must be empty.
+    void setStorage(ArchetypeStorage storage);
+    void setEntity(std::size_t row, Entity entity);
     void popEntity();
 
     Entity* entityData();
-    Entity getEntity(component_id row);
-    BlobVector* getColumn(component_id bit);
+    Entity getEntity(std::size_t row);
+    /// Returns the component's column, or null when the archetype has no column for it.
+    BlobVector* getColumn(component_id id) {
+        auto index = this->columnIndex(id);
+        return index != npos ? &this->_columns[index] : nullptr;
+    }
+
+    BlobVector* columnAt(std::size_t index);
+    std::size_t columnCount() const;
+
+    /// Returns the position of the component's column, which stays valid for the archetype's lifetime, or
+    /// `npos` when the archetype has no column for it.
+    std::size_t columnIndex(component_id id) const {
+        if (id >= this->_columnIndices.size() || this->_columnIndices[id] == noColumn) {
+            return npos;
+        }
+
+        return this->_columnIndices[id];
+    }
 
     std::size_t length() const;
-    component_id bitmask() const;
+    const Signature& bitmask() const;
+    ArchetypeStorage storage() const;
+
+    /// Rows per block in chunked storage, or the whole length for contiguous storage.
+    std::size_t chunkRows() const;
+    /// Number of chunks the rows are split into. Contiguous archetypes always have exactly one.
+    std::size_t chunkCount() const;
+
+    /// Returns the start of a block of chunked storage, which holds `chunkRows` rows of every column.
+    std::byte* block(std::size_t index);
+    /// Size of every block in chunked storage, zero for contiguous storage.
+    std::size_t blockBytes() const;
+    /// Uses `count` consecutive blocks laid out like this archetype's own as its first blocks, without
+    /// copying them. The archetype must be chunked and hold no blocks yet. `owner` keeps the memory alive
+    /// for as long as the archetype uses it.
+    void adoptBlocks(std::byte* blocks, std::size_t count, std::shared_ptr<const void> owner);
+
+    ArchetypeEdges& insertEdges();
+    ArchetypeEdges& removeEdges();
+    /// Edges keyed by the target's whole bitmask, for transitions that both add and remove components.
+    ArchetypeEdges& moveEdges();
 
     Archetype(Archetype&&) noexcept = default;
     Archetype& operator=(Archetype&&) noexcept = default;
@@ -56,31 +172,102 @@ public:
 
     ~Archetype() = default;
 private:
-    component_id _bitmask;
-    std::unordered_map<component_id, std::size_t> _columnMap;
+    /// Allocates blocks until every column of a chunked archetype can hold the given number of rows.
+    void ensureChunks(std::size_t rows);
+
+    static constexpr std::uint16_t noColumn = std::numeric_limits<std::uint16_t>::max();
+    static_assert(Signature::capacity < noColumn);
+
+    Signature _bitmask;
+    /// Column position of every component id up to the highest one with a column, `noColumn` for the rest.
+    std::vector<std::uint16_t> _columnIndices;
+    ArchetypeStorage _storage = ArchetypeStorage::Contiguous;
+    std::size_t _chunkRows = 0;
+    std::size_t _chunkBytes = 0;
+    /// Offset of every column inside a block.
+    std::vector<std::size_t> _chunkOffsets;
+    /// Owner of adopted blocks, if any.
+    std::shared_ptr<const void> _adopted;
+    // Blocks must outlive the columns whose elements they hold.
+    std::vector<std::unique_ptr<std::byte[], ChunkDeleter>> _chunks;
     std::vector<BlobVector> _columns;
     std::vector<Entity> _entities;
     std::shared_ptr<Components> _components;
+
+    ArchetypeEdges _insertEdges;
+    ArchetypeEdges _removeEdges;
+    ArchetypeEdges _moveEdges;
 };
 
 class Archetypes {
 public:
+    /// Index of the archetype without any components.
+    static constexpr std::size_t root = 0;
+
     Archetypes() {}
     explicit Archetypes(std::shared_ptr<Components> components);
 
-    void add(component_id bit, Archetype&& archetype);
-    void moveEntity(Entity entity, component_id from, component_id to, Entities* entities);
+    void add(const Signature& bitmask, Archetype&& archetype);
+    /// Moves the entity over the edge. Components the target adds are uninitialized and added at the tick.
+    void moveEntity(Entity entity, const ArchetypeEdge& edge, Entities* entities, Tick tick);
+
+    /// Destroys the entity's row and clears its location.
+    void removeEntity(Entity entity, Entities* entities);
+
+    /// Destroys the given rows, which must be sorted from the highest down, filling every gap with the
+    /// archetype's last row. Locations of removed entities are cleared.
+    void removeRows(std::size_t archetype, const std::vector<std::size_t>& rows, Entities* entities);
+
+    /// Moves every row of the archetype over the edge at once and returns the first row in the target.
+    std::size_t moveAll(std::size_t from, const ArchetypeEdge& edge, Entities* entities, Tick tick);
+
+    /// Returns the edge leading from the archetype to the one extended by the bitmask, resolving it when
+    /// the transition is taken for the first time. Repeated transitions don't hash.
+    const ArchetypeEdge& insertEdge(std::size_t from, const Signature& bitmask);
 
-    Archetype* getOrCreate(component_id bit);
-    Archetype* get(component_id bit);
+    /// Returns the edge leading from the archetype to the one without components of the bitmask.
+    const ArchetypeEdge& removeEdge(std::size_t from, const Signature& bitmask);
+
+    /// Returns the edge leading from the archetype to the one with exactly the target bitmask. The edge's
+    /// bundle columns cover components the target adds.
+    const ArchetypeEdge& transitionEdge(std::size_t from, const Signature& target);
+
+    /// Sets the storage of archetypes created from now on. Existing archetypes keep theirs.
+    void setDefaultStorage(ArchetypeStorage storage);
+
+    /// Creates the sparse set of a component registered with sparse storage.
+    void addSparseSet(component_id id, TypeInfo typeInfo);
+
+    /// Returns the sparse set of the component, or null for table components.
+    SparseSet* sparseSet(component_id id) {
+        return this->_sparseMask.test(id) ? this->_sparseSets[id].get() : nullptr;
+    }
+
+    /// Returns every component kept in a sparse set.
+    const Signature& sparseMask() const;
+
+    /// Returns every tag, which archetypes hold in their bitmask only.
+    const Signature& tagMask() const;
+
+    /// Destroys every sparse component of the entity.
+    void removeSparse(EntityId id);
+
+    Archetype* getOrCreate(const Signature& bitmask);
+    Archetype* get(const Signature& bitmask);
     Archetype* at(std::size_t index);
     std::deque<Archetype>& archetypes();
 
-    std::size_t position(component_id bit) const;
-    bool exists(component_id bit) const;
+    std::size_t position(const Signature& bitmask) const;
+    bool exists(const Signature& bitmask) const;
     std::size_t length() const;
 private:
-    std::unordered_map<component_id, std::size_t> _archetypeMap;
+    void resolveEdge(ArchetypeEdge& edge, std::size_t from, const Signature& target, const Signature& bundle);
+
+    std::unordered_map<Signature, std::size_t> _archetypeMap;
     std::deque<Archetype> _archetypes;
     std::shared_ptr<Components> _components;
+    ArchetypeStorage _defaultStorage = ArchetypeStorage::Contiguous;
+    /// Sparse set of every sparse component, indexed by component id.
+    std::vector<std::unique_ptr<SparseSet>> _sparseSets;
+    Signature _sparseMask;
 };
@@ -0,0 +1,115 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+Arena::Arena(std::size_t blockSize) {
+    this->_blockSize = blockSize;
+}
+
+std::byte* Arena::allocate(std::size_t size, std::size_t align) {
+    assert(align <= blockAlign && (align & (align - 1)) == 0);
+
+    while (this->_current < this->_blocks.size()) {
+        auto& block = this->_blocks[this->_current];
+        auto offset = (this->_offset + align - 1) & ~(align - 1);
+
+        if (offset + size <= block.size) {
+            this->_offset = offset + size;
+            this->_used += size;
+            return block.data + offset;
+        }
+
+        this->_current++;
+        this->_offset = 0;
+    }
+
+    auto block = allocateBlock(std::max(size, this->_blockSize));
+    this->_blocks.push_back(block);
+    this->_current = this->_blocks.size() - 1;
+    this->_offset = size;
+    this->_used += size;
+
+    return block.data;
+}
+
+void Arena::reset() {
+    for (auto block : this->_adopted) {
+        this->_blocks.push_back(block);
+    }
+    this->_adopted.clear();
+
+    this->_current = 0;
+    this->_offset = 0;
+    this->_used = 0;
+}
+
+void Arena::append(Arena&& other) {
+    if (this == &other) {
+        return;
+    }
+
+    for (auto block : other._blocks) {
+        this->_adopted.push_back(block);
+    }
+    for (auto block : other._adopted) {
+        this->_adopted.push_back(block);
+    }
+
+    this->_used += other._used;
+
+    other._blocks.clear();
+    other._adopted.clear();
+    other._current = 0;
+    other._offset = 0;
+    other._used = 0;
+}
+
+std::size_t Arena::used() const {
+    return this->_used;
+}
+
+Arena::Arena(Arena&& other) noexcept {
+    this->_blocks = std::move(other._blocks);
+    this->_adopted = std::move(other._adopted);
+    this->_blockSize = other._blockSize;
+    this->_current = other._current;
+    this->_offset = other._offset;
+    this->_used = other._used;
+
+    other._blocks.clear();
+    other._adopted.clear();
+    other._current = 0;
+    other._offset = 0;
+    other._used = 0;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    this->~Arena();
+    new(this) Arena(std::move(other));
+
+    return *this;
+}
+
+Arena::Block Arena::allocateBlock(std::size_t size) {
+    auto data = static_cast<std::byte*>(operator new(size, std::align_val_t{blockAlign}));
+    return Block{ data, size };
+}
+
+void Arena::releaseBlock(Block block) {
+    operator delete(block.data, block.size, std::align_val_t{blockAlign});
+}
+
+Arena::~Arena() {
+    for (auto block : this->_blocks) {
+        releaseBlock(block);
+    }
+    for (auto block : this->_adopted) {
+        releaseBlock(block);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// Linear allocator handing out memory from fixed-size blocks. Allocated memory never moves, so pointers
+/// stay valid until `reset`. Objects placed in the arena aren't destroyed by it.
+class Arena {
+public:
+    static constexpr std::size_t blockAlign = 64;
+
+    explicit Arena(std::size_t blockSize = 64 * 1024);
+
+    /// Returns uninitialized memory of the given size and alignment. Requests larger than a block get a
+    /// dedicated block.
+    [[nodiscard]] std::byte* allocate(std::size_t size, std::size_t align);
+
+    /// Releases every allocation at once. Blocks are kept and reused by later allocations.
+    void reset();
+
+    /// Takes over the blocks of the other arena, keeping its allocations alive until the next reset.
+    void append(Arena&& other);
+
+    /// Returns the number of bytes handed out since the last reset.
+    std::size_t used() const;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    ~Arena();
+
+private:
+    struct Block {
+        std::byte* data;
+        std::size_t size;
+    };
+
+    static Block allocateBlock(std::size_t size);
+    static void releaseBlock(Block block);
+
+    /// Blocks in allocation order, those after `_current` are free.
+    std::vector<Block> _blocks;
+    /// Blocks taken over from other arenas, freed for reuse on reset.
+    std::vector<Block> _adopted;
+
+    std::size_t _blockSize;
+    std::size_t _current = 0;
+    std::size_t _offset = 0;
+    std::size_t _used = 0;
+};
@@ -8,18 +8,22 @@ BlobVector::BlobVector(TypeInfo typeInfo) {
     this->_length = 0;
 
     this->_type_info = typeInfo;
+    this->_pageTicks.assign(1, PageTicks{});
 }
 
 void BlobVector::resize(std::size_t new_capacity) {
+    assert(this->_pageRows == 0 && "paged vectors get their memory from the owner");
+
+    auto align = std::max(this->_type_info.align, bufferAlign);
     std::byte* new_ptr = static_cast<std::byte*>(operator new(
         new_capacity * this->_type_info.size,
-        std::align_val_t{this->_type_info.align}
+        std::align_val_t{align}
     ));
 
     if (this->_ptr) {
         if (this->_type_info.trivially_relocatable) {
             std::copy(this->_ptr, this->_ptr + this->_length * this->_type_info.size, new_ptr);
-            operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{this->_type_info.align});
+            operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{align});
         } else {
             for (std::size_t i = 0; i < this->_length; ++i) {
                 std::byte* old_item = this->_ptr + i * this->_type_info.size;
@@ -28,7 +32,7 @@ void BlobVector::resize(std::size_t new_capacity) {
                 this->_type_info.move_construct(new_item, old_item);
                 this->_type_info.destructor(old_item);
             }
-            operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{this->_type_info.align});
+            operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{align});
         }
     }
 
@@ -36,27 +40,109 @@ void BlobVector::resize(std::size_t new_capacity) {
     this->_capacity = new_capacity;
 }
 
-void BlobVector::grow(std::size_t length) {
-    if (this->_length == this->_capacity) {
-        resize(this->_capacity == 0 ? 4 : this->_capacity * 2);
+void BlobVector::reserve(std::size_t capacity) {
+    if (capacity > this->_capacity) {
+        resize(capacity);
+    }
+}
+
+void BlobVector::usePages(std::size_t rowsPerPage) {
+    assert(rowsPerPage > 0);
+    assert(this->_ptr == nullptr && this->_pages.empty());
+
+    this->_pageRows = rowsPerPage;
+    this->_pageTicks.clear();
+}
+
+void BlobVector::addPage(std::byte* page) {
+    assert(this->_pageRows > 0);
+
+    this->_pages.push_back(page);
+    this->_pageTicks.push_back(PageTicks{});
+    this->_capacity += this->_pageRows;
+}
+
+void BlobVector::ensureCapacity(std::size_t additional) {
+    if (this->_length + additional > this->_capacity) {
+        resize(std::max(this->_length + additional, this->_capacity == 0 ? 4 : this->_capacity * 2));
+    }
+}
+
+void BlobVector::stamp(std::size_t index, std::size_t count, Tick tick) {
+    assert(index == this->_added.size());
+
+    this->_added.resize(index + count, tick);
+    this->_changed.resize(index + count, tick);
+    this->touch(index, count, tick);
+}
+
+void BlobVector::touch(std::size_t index, std::size_t count, Tick tick) {
+    if (count == 0) {
+        return;
+    }
+
+    for (auto page = this->pageOf(index); page <= this->pageOf(index + count - 1); ++page) {
+        this->_pageTicks[page].latest = latestTick(this->_pageTicks[page].latest, tick);
+    }
+}
+
+void BlobVector::flushPage(std::size_t page) {
+    auto& ticks = this->_pageTicks[page];
+
+    if (!ticks.hasBulk) {
+        return;
+    }
+
+    auto begin = page * this->_pageRows;
+    auto end = this->_pageRows == 0 ? this->_length : std::min(this->_length, begin + this->_pageRows);
+
+    for (auto i = begin; i < end; ++i) {
+        this->_changed[i] = latestTick(this->_changed[i], ticks.bulk);
+    }
+
+    ticks.hasBulk = false;
+}
+
+void BlobVector::flushPages() {
+    for (std::size_t page = 0; page < this->_pageTicks.size(); ++page) {
+        this->flushPage(page);
     }
-    this->_length += length;
 }
 
-void BlobVector::push(std::byte* bytes) {
-    if (this->_length == this->_capacity) {
-        resize(this->_capacity == 0 ? 4 : this->_capacity * 2);
+void BlobVector::clampTicks(Tick thisRun) {
+    for (auto& tick : this->_added) {
+        tick = clampTick(tick, thisRun);
+    }
+
+    for (auto& tick : this->_changed) {
+        tick = clampTick(tick, thisRun);
     }
 
-    auto address = this->_ptr + this->_length * this->_type_info.size;
+    for (auto& ticks : this->_pageTicks) {
+        ticks.latest = clampTick(ticks.latest, thisRun);
+        ticks.bulk = clampTick(ticks.bulk, thisRun);
+    }
+}
+
+void BlobVector::grow(std::size_t length, Tick tick) {
+    this->ensureCapacity(length);
+    this->_length += length;
+    this->stamp(this->_length - length, length, tick);
+}
+
+void BlobVector::push(std::byte* bytes, Tick tick) {
+    this->ensureCapacity(1);
+
+    auto address = this->address(this->_length);
     std::copy(bytes, bytes + this->_type_info.size, address);
     this->_length++;
+    this->stamp(this->_length - 1, 1, tick);
 }
 
 void BlobVector::set(std::size_t index, std::byte* bytes) {
     assert(index < this->_length);
 
-    auto address = this->_ptr + index * this->_type_info.size;
+    auto address = this->address(index);
 
     if (this->_type_info.trivially_relocatable) {
         std::copy(bytes, bytes + this->_type_info.size, address);
@@ -65,6 +151,22 @@ void BlobVector::set(std::size_t index, std::byte* bytes) {
     }
 }
 
+void BlobVector::setRange(std::size_t index, std::byte* bytes, std::size_t count) {
+    auto size = this->_type_info.size;
+
+    this->forEachRange(index, count, [&](std::byte* address, std::size_t run) {
+        if (this->_type_info.trivially_relocatable) {
+            std::copy(bytes, bytes + run * size, address);
+        } else {
+            for (std::size_t i = 0; i < run; ++i) {
+                this->_type_info.move_construct(address + i * size, bytes + i * size);
+            }
+        }
+
+        bytes += run * size;
+    });
+}
+
 void BlobVector::replace(std::size_t index, std::byte* bytes) {
     assert(index < this->_length);
 
@@ -79,6 +181,89 @@ void BlobVector::replace(std::size_t index, std::byte* bytes) {
     }
 }
 
+void BlobVector::append(BlobVector& other) {
+    assert(this->_type_info.size == other._type_info.size);
+
+    // Moved rows carry their own ticks, not the bulk ticks of either side.
+    this->flushPages();
+    other.flushPages();
+
+    if (this->_length == 0 && this->_pageRows == 0 && other._pageRows == 0) {
+        std::swap(this->_ptr, other._ptr);
+        std::swap(this->_capacity, other._capacity);
+        std::swap(this->_length, other._length);
+        std::swap(this->_added, other._added);
+        std::swap(this->_changed, other._changed);
+        this->_pageTicks[0].latest = latestTick(this->_pageTicks[0].latest, other._pageTicks[0].latest);
+        other._added.clear();
+        other._changed.clear();
+        return;
+    }
+
+    if (this->_pageRows > 0 || other._pageRows > 0) {
+        this->ensureCapacity(other._length);
+
+        for (std::size_t i = 0; i < other._length; ++i) {
+            auto item = other.address(i);
+            auto dest = this->address(this->_length + i);
+
+            if (this->_type_info.trivially_relocatable) {
+                std::copy(item, item + this->_type_info.size, dest);
+            } else {
+                this->_type_info.move_construct(dest, item);
+                this->_type_info.destructor(item);
+            }
+
+            this->_added.push_back(other._added[i]);
+            this->_changed.push_back(other._changed[i]);
+            this->touch(this->_length + i, 1, other._changed[i]);
+        }
+
+        this->_length += other._length;
+        other._length = 0;
+        other._added.clear();
+        other._changed.clear();
+        return;
+    }
+
+    this->reserve(this->_length + other._length);
+    this->_added.insert(this->_added.end(), other._added.begin(), other._added.end());
+    this->_changed.insert(this->_changed.end(), other._changed.begin(), other._changed.end());
+    this->_pageTicks[0].latest = latestTick(this->_pageTicks[0].latest, other._pageTicks[0].latest);
+    other._added.clear();
+    other._changed.clear();
+
+    auto dest = this->_ptr + this->_length * this->_type_info.size;
+
+    if (this->_type_info.trivially_relocatable) {
+        std::copy(other._ptr, other._ptr + other._length * this->_type_info.size, dest);
+    } else {
+        for (std::size_t i = 0; i < other._length; ++i) {
+            auto item = other._ptr + i * this->_type_info.size;
+
+            this->_type_info.move_construct(dest + i * this->_type_info.size, item);
+            this->_type_info.destructor(item);
+        }
+    }
+
+    this->_length += other._length;
+    other._length = 0;
+}
+
+void BlobVector::clear() {
+    for (std::size_t i = 0; i < this->_length; ++i) {
+        this->_type_info.destructor(this->address(i));
+    }
+
+    this->_length = 0;
+    this->_added.clear();
+    this->_changed.clear();
+
+    for (auto& ticks : this->_pageTicks) {
+        ticks.hasBulk = false;
+    }
+}
+
 void BlobVector::swap(std::size_t a, std::size_t b) {
     assert(a < this->_length);
     assert(b < this->_length);
@@ -88,6 +273,14 @@ void BlobVector::swap(std::size_t a, std::size_t b) {
 
     if (a == b) return;
 
+    this->flushPage(this->pageOf(a));
+    this->flushPage(this->pageOf(b));
+
+    std::swap(this->_added[a], this->_added[b]);
+    std::swap(this->_changed[a], this->_changed[b]);
+    this->touch(a, 1, this->_changed[a]);
+    this->touch(b, 1, this->_changed[b]);
+
     if (this->_type_info.trivially_relocatable) {
         alignas(std::max_align_t) std::byte temp_stack[64];
         std::byte* temp = temp_stack;
@@ -114,7 +307,9 @@ std::byte* BlobVector::pop() {
     assert(this->_length > 0);
 
     this->_length--;
-    return this->get(this->_length);
+    this->_added.pop_back();
+    this->_changed.pop_back();
+    return this->address(this->_length);
 }
 
 std::byte* BlobVector::swapRemove(std::size_t index) {
@@ -124,10 +319,80 @@ std::byte* BlobVector::swapRemove(std::size_t index) {
     return this->pop();
 }
 
+void BlobVector::removeUninitialized(std::size_t index) {
+    assert(index < this->_length);
+
+    auto last = this->_length - 1;
+
+    if (index != last) {
+        this->flushPage(this->pageOf(index));
+        this->flushPage(this->pageOf(last));
+
+        auto gap = this->address(index);
+        auto lastItem = this->address(last);
+
+        if (this->_type_info.trivially_relocatable) {
+            std::copy(lastItem, lastItem + this->_type_info.size, gap);
+        } else {
+            this->_type_info.move_construct(gap, lastItem);
+            this->_type_info.destructor(lastItem);
+        }
+
+        this->_added[index] = this->_added[last];
+        this->_changed[index] = this->_changed[last];
+        this->touch(index, 1, this->_changed[index]);
+    }
+
+    this->_length--;
+    this->_added.pop_back();
+    this->_changed.pop_back();
+}
+
 std::byte* BlobVector::get(std::size_t index) {
     assert(index < this->_length);
 
-    return this->_ptr + index * this->_type_info.size;
+    return this->address(index);
+}
+
+Tick* BlobVector::addedTicks() {
+    return this->_added.data();
+}
+
+Tick* BlobVector::changedTicks() {
+    return this->_changed.data();
+}
+
+ComponentTicks BlobVector::ticks(std::size_t index) const {
+    assert(index < this->_length);
+
+    const auto& page = this->_pageTicks[this->pageOf(index)];
+    auto changed = page.hasBulk ? latestTick(this->_changed[index], page.bulk) : this->_changed[index];
+
+    return ComponentTicks{ this->_added[index], changed };
+}
+
+void BlobVector::setTicks(std::size_t index, ComponentTicks ticks) {
+    assert(index < this->_length);
+
+    this->flushPage(this->pageOf(index));
+
+    this->_added[index] = ticks.added;
+    this->_changed[index] = ticks.changed;
+    this->touch(index, 1, ticks.changed);
+}
+
+void BlobVector::markChanged(std::size_t index, std::size_t count, Tick tick) {
+    assert(index + count <= this->_length);
+
+    std::fill_n(this->_changed.begin() + index, count, tick);
+
+    this->touch(index, count, tick);
+}
+
+PageTicks* BlobVector::pageTicks(std::size_t page) {
+    assert(page < this->_pageTicks.size());
+
+    return &this->_pageTicks[page];
 }
 
 std::byte* BlobVector::last() {
@@ -137,9 +402,25 @@ std::byte* BlobVector::last() {
 }
 
 std::byte* BlobVector::data() const {
+    assert(this->_pageRows == 0);
+
     return this->_ptr;
 }
 
+std::byte* BlobVector::page(std::size_t index) const {
+    if (this->_pageRows == 0) {
+        assert(index == 0);
+        return this->_ptr;
+    }
+
+    assert(index < this->_pages.size());
+    return this->_pages[index];
+}
+
+bool BlobVector::paged() const {
+    return this->_pageRows > 0;
+}
+
 std::size_t BlobVector::capacity() const {
     return this->_capacity;
 }
@@ -152,12 +433,21 @@ TypeInfo BlobVector::typeInfo() const {
     return this->_type_info;
 }
 
-BlobVector::~BlobVector() {
+void BlobVector::release() {
+    // Call destructor for each element
+    for (std::size_t i = 0; i < this->_length; ++i) {
+        this->_type_info.destructor(this->address(i));
+    }
+
     if (this->_ptr) {
-        // Call destructor for each element
-        for (std::size_t i = 0; i < this->_length; ++i) {
-            this->_type_info.destructor(this->get(i));
-        }
-        operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{this->_type_info.align});
+        auto align = std::max(this->_type_info.align, bufferAlign);
+        operator delete(this->_ptr, this->_capacity * this->_type_info.size, std::align_val_t{align});
     }
+
+    this->_ptr = nullptr;
+    this->_length = 0;
+}
+
+BlobVector::~BlobVector() {
+    this->release();
 }
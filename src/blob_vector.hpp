@@ -1,9 +1,13 @@
 #pragma once
 
+#include "tick.hpp"
+
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <print>
 #include <utility>
+#include <vector>
 
 template<typename T>
 concept TriviallyCopyable = std::is_trivially_copyable_v<T>;
@@ -18,6 +22,7 @@ concept TriviallyRelocatable = IsTriviallyRelocatable<T>::value;
 struct TypeInfo {
     bool trivially_relocatable;
 
+    /// Zero for tags, empty types that only exist in archetype signatures and never get a column.
     std::size_t size;
     std::size_t align;
 
@@ -29,7 +34,7 @@ struct TypeInfo {
     static constexpr TypeInfo Of() {
         return TypeInfo{
             .trivially_relocatable = TriviallyRelocatable<T>,
-            .size = sizeof(T),
+            .size = std::is_empty_v<T> ? 0 : sizeof(T),
             .align = alignof(T),
             .destructor = [](std::byte* ptr) {
                 reinterpret_cast<T*>(ptr)->~T();
@@ -47,6 +52,9 @@ struct TypeInfo {
 
 class BlobVector {
 public:
+    /// Alignment of every buffer and page start, wide enough for any vector load.
+    static constexpr std::size_t bufferAlign = 64;
+
     BlobVector(TypeInfo typeInfo);
 
     /// Creates a new BlobVector for the given type. Doesn't allocate new memory.
@@ -59,31 +67,47 @@ public:
     /// Resizes the vector to the given capacity, allocating new memory if necessary.
     void resize(std::size_t new_capacity);
 
+    /// Makes sure the vector can hold the given number of elements without reallocating.
+    void reserve(std::size_t capacity);
+
+    /// Switches an empty vector to paged storage, where elements live in externally owned pages of
+    /// `rowsPerPage` elements each. Paged vectors never relocate their elements and never allocate, the
+    /// owner has to add pages before the vector outgrows them.
+    void usePages(std::size_t rowsPerPage);
+
+    /// Adds a page of `rowsPerPage` elements to the end of a paged vector. The page is not owned.
+    void addPage(std::byte* page);
+
+    /// Constructs an element at the end of the vector, added and changed at the given tick.
     template<typename T, typename... Args>
-    void emplace(Args&&... args) {
+    void emplace(Tick tick, Args&&... args) {
         assert(this->validate<T>());
 
-        if (this->_length == this->_capacity) {
-            resize(this->_capacity == 0 ? 4 : this->_capacity * 2);
-        }
+        this->ensureCapacity(1);
 
-        auto address = this->data() + this->_length * this->_type_info.size;
+        auto address = this->address(this->_length);
         new(address) T(std::forward<Args>(args)...);
         this->_length++;
+        this->stamp(this->_length - 1, 1, tick);
     }
 
-    /// Grows the vector by the given length, allocating new memory if necessary.
-    void grow(std::size_t length);
+    /// Grows the vector by the given length, allocating new memory if necessary. New elements are
+    /// uninitialized, and added and changed at the given tick.
+    void grow(std::size_t length, Tick tick);
 
     /// Pushes element's bytes into back of the vector, while allocating new memory if necessary.
     /// Bytes are copied into the vector and thus the object should not be used unless it is
     /// trivially copyable.
-    void push(std::byte* bytes);
+    void push(std::byte* bytes, Tick tick);
 
     /// Sets element's bytes at the given index. Doesn't call the destructor of the old element
     /// because it should be called on uninitialized memory.
     void set(std::size_t index, std::byte* bytes);
 
+    /// Sets `count` elements starting at the given index from contiguous bytes. Trivially relocatable
+    /// elements are copied at once, others are move constructed one by one.
+    void setRange(std::size_t index, std::byte* bytes, std::size_t count);
+
     /// Sets element at the given index. Doesn't call the destructor of the old element
     /// because it should be called on uninitialized memory.
     template<typename T, typename... Args>
@@ -111,6 +135,14 @@ public:
         }
     }
 
+    /// Moves every element of the other vector to the end of this one, leaving the other vector empty. Ticks
+    /// move along with the elements. When this vector is empty and neither is paged, buffers are swapped
+    /// instead of moving elements.
+    void append(BlobVector& other);
+
+    /// Destroys every element, keeping the allocated memory.
+    void clear();
+
     /// Swaps the elements at the given indices.
     void swap(std::size_t a, std::size_t b);
 
@@ -140,8 +172,35 @@ public:
         reinterpret_cast<T*>(swapRemove(index))->~T();
     }
 
+    /// Removes the element at the given index whose memory was already moved out or destroyed, relocating
+    /// the last element into the gap. No destructor is called.
+    void removeUninitialized(std::size_t index);
+
     [[nodiscard]] std::byte* get(std::size_t index);
 
+    /// Returns added ticks of every element, which are contiguous even when the elements are paged.
+    [[nodiscard]] Tick* addedTicks();
+    /// Returns changed ticks of every element, which are contiguous even when the elements are paged.
+    [[nodiscard]] Tick* changedTicks();
+    [[nodiscard]] ComponentTicks ticks(std::size_t index) const;
+
+    /// Sets the ticks of an element, used when it moves in from another vector.
+    void setTicks(std::size_t index, ComponentTicks ticks);
+
+    /// Marks `count` elements starting at the given index as changed at the tick.
+    void markChanged(std::size_t index, std::size_t count, Tick tick);
+
+    /// Returns change ticks of the page. Whole pages are skipped by change filters when their latest tick
+    /// is older than the filter's last run.
+    [[nodiscard]] PageTicks* pageTicks(std::size_t page);
+
+    /// Merges the bulk tick of every page into the ticks of its rows, so `addedTicks` and `changedTicks`
+    /// alone tell when every row was added and changed.
+    void flushPages();
+
+    /// Pulls ticks older than the maximum age as seen from `thisRun` up to it, see clampTick.
+    void clampTicks(Tick thisRun);
+
     template<typename T>
     [[nodiscard]] T* get(std::size_t index) {
         assert(this->validate<T>());
@@ -165,7 +224,33 @@ public:
         return reinterpret_cast<T*>(data());
     }
 
+    /// Calls `func(std::byte* ptr, std::size_t count)` for every contiguous run of the elements in
+    /// `[begin, begin + count)`. Contiguous vectors have a single run, paged ones one per touched page.
+    template<typename Func>
+    void forEachRange(std::size_t begin, std::size_t count, Func&& func) {
+        assert(begin + count <= this->_length);
+
+        if (this->_pageRows == 0) {
+            if (count > 0) {
+                func(this->_ptr + begin * this->_type_info.size, count);
+            }
+            return;
+        }
+
+        while (count > 0) {
+            auto run = std::min(count, this->_pageRows - begin % this->_pageRows);
+            func(this->address(begin), run);
+
+            begin += run;
+            count -= run;
+        }
+    }
+
+    /// Returns the contiguous buffer. Paged vectors have none, use `page` or `forEachRange` instead.
     [[nodiscard]] std::byte* data() const;
+    /// Returns the start of the page, the whole buffer for contiguous vectors which have a single page.
+    [[nodiscard]] std::byte* page(std::size_t index) const;
+    [[nodiscard]] bool paged() const;
     [[nodiscard]] std::size_t capacity() const;
     [[nodiscard]] std::size_t length() const;
     [[nodiscard]] TypeInfo typeInfo() const;
@@ -185,10 +270,20 @@ public:
         this->_capacity = other._capacity;
         this->_length = other._length;
         this->_type_info = other._type_info;
+        this->_pages = std::move(other._pages);
+        this->_pageRows = other._pageRows;
+        this->_added = std::move(other._added);
+        this->_changed = std::move(other._changed);
+        this->_pageTicks = std::move(other._pageTicks);
 
         other._ptr = nullptr;
         other._capacity = 0;
         other._length = 0;
+        other._pages.clear();
+        other._pageRows = 0;
+        other._added.clear();
+        other._changed.clear();
+        other._pageTicks.assign(1, PageTicks{});
     }
 
     BlobVector& operator=(BlobVector&& other) noexcept {
@@ -196,16 +291,26 @@ public:
             return *this;
         }
 
-        this->~BlobVector();
+        this->release();
 
         this->_ptr = other._ptr;
         this->_capacity = other._capacity;
         this->_length = other._length;
         this->_type_info = other._type_info;
+        this->_pages = std::move(other._pages);
+        this->_pageRows = other._pageRows;
+        this->_added = std::move(other._added);
+        this->_changed = std::move(other._changed);
+        this->_pageTicks = std::move(other._pageTicks);
 
         other._ptr = nullptr;
         other._capacity = 0;
         other._length = 0;
+        other._pages.clear();
+        other._pageRows = 0;
+        other._added.clear();
+        other._changed.clear();
+        other._pageTicks.assign(1, PageTicks{});
 
         return *this;
     }
@@ -213,9 +318,46 @@ public:
     ~BlobVector();
 
 private:
+    /// Destroys every element and frees the buffer.
+    void release();
+
+    /// Makes room for the given number of additional elements, which paged vectors must already have.
+    void ensureCapacity(std::size_t additional);
+
+    /// Sets added and changed ticks of new elements.
+    void stamp(std::size_t index, std::size_t count, Tick tick);
+
+    /// Moves latest ticks of the elements' pages up to the tick.
+    void touch(std::size_t index, std::size_t count, Tick tick);
+
+    /// Merges the page's bulk tick into the ticks of its rows, before rows enter or leave it.
+    void flushPage(std::size_t page);
+
+    [[nodiscard]] std::size_t pageOf(std::size_t index) const {
+        return this->_pageRows == 0 ? 0 : index / this->_pageRows;
+    }
+
+    [[nodiscard]] std::byte* address(std::size_t index) const {
+        if (this->_pageRows == 0) {
+            return this->_ptr + index * this->_type_info.size;
+        }
+
+        return this->_pages[index / this->_pageRows] + (index % this->_pageRows) * this->_type_info.size;
+    }
+
     std::byte* _ptr;
     std::size_t _capacity;
     std::size_t _length;
 
     TypeInfo _type_info;
+
+    std::vector<std::byte*> _pages;
+    /// Elements per page, zero for a contiguous vector.
+    std::size_t _pageRows = 0;
+
+    // Added and changed ticks are kept apart, so marking rows as changed is a plain fill.
+    std::vector<Tick> _added;
+    std::vector<Tick> _changed;
+    /// One tick per page, contiguous vectors count as a single page.
+    std::vector<PageTicks> _pageTicks;
 };
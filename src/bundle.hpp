@@ -3,51 +3,44 @@
 #include "components.hpp"
 
 #include <cstddef>
-#include <functional>
-#include <memory>
-#include <print>
 
+/// View of components laid out back to back in id order, without padding, as FFI callers hand them over.
+/// The bundle doesn't own the bytes. Trivially relocatable components are relocated into the world and
+/// must not be destroyed by the caller afterwards, others are move constructed out of the buffer.
 class Bundle {
 public:
-    component_id bitmask;
+    Signature bitmask;
 public:
-    Bundle(component_id bitmask);
-    Bundle(std::shared_ptr<Components> components, component_id bitmask, std::byte* data, std::size_t count, bool owned);
-
-    void transfer(std::function<void(component_id, std::byte*)> dest);
-
-    Bundle(Bundle&& other) noexcept
-            : bitmask(other.bitmask),
-              _components(std::move(other._components)),
-              _ownedData(std::move(other._ownedData)),
-              _data(std::move(other._data)),
-              _count(other._count)
-    {
-        other.bitmask = 0;
-    }
+    /// Creates a bundle without data, as used to remove components.
+    explicit Bundle(const Signature& bitmask);
+    Bundle(const Components* components, const Signature& bitmask, std::byte* data, std::size_t count);
+
+    /// Calls `dest` with the id and bytes of every component in id order. Tags have no bytes and are skipped.
+    template<typename Func>
+    void transfer(Func&& dest) const {
+        if (this->_count == 0 || this->_data == nullptr) {
+            return;
+        }
 
-    Bundle& operator=(Bundle&& other) noexcept {
-        if (this != &other) {
-            this->~Bundle();
+        std::byte* data = this->_data;
+        std::size_t index = 0;
 
-            bitmask = std::move(other.bitmask);
-            _components = std::move(other._components);
-            _ownedData = std::move(other._ownedData);
-            _data = std::move(other._data);
-            _count = other._count;
+        this->bitmask.forEach([&](component_id id) {
+            if (index++ >= this->_count) return;
 
-            other.bitmask = 0;
-        }
-        return *this;
-    }
+            auto size = this->_components->getTypeInfo(id).size;
 
-    Bundle(const Bundle&) = delete;
-    Bundle& operator=(const Bundle&) = delete;
+            // Tags carry no bytes, their bit is all there is.
+            if (size == 0) return;
+
+            dest(id, data);
+
+            data += size;
+        });
+    }
 
-    ~Bundle();
 private:
-    std::shared_ptr<Components> _components;
-    std::unique_ptr<std::byte[]> _ownedData;
-    std::byte* _data;
-    std::size_t _count;
+    const Components* _components = nullptr;
+    std::byte* _data = nullptr;
+    std::size_t _count = 0;
 };
@@ -0,0 +1,441 @@
+#include "command_buffer.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+
+namespace {
+    bool signatureLess(const Signature& lhs, const Signature& rhs) {
+        return std::lexicographical_compare(
+            std::begin(lhs.words), std::end(lhs.words),
+            std::begin(rhs.words), std::end(rhs.words)
+        );
+    }
+
+    /// Moves the bytes into the column's row and ends the lifetime of the source object. Replaced components
+    /// are marked as changed.
+    void moveInto(BlobVector* column, std::size_t row, std::byte* bytes, bool replace, Tick tick) {
+        if (replace) {
+            column->replace(row, bytes);
+            column->markChanged(row, 1, tick);
+        } else {
+            column->set(row, bytes);
+        }
+
+        auto info = column->typeInfo();
+        if (!info.trivially_relocatable) {
+            info.destructor(bytes);
+        }
+    }
+
+    /// Moves the bytes into the entity's sparse component and ends the lifetime of the source object.
+    void moveInto(SparseSet* set, Entity entity, std::byte* bytes, Tick tick) {
+        set->insert(entity, bytes, tick);
+
+        auto info = set->dense().typeInfo();
+        if (!info.trivially_relocatable) {
+            info.destructor(bytes);
+        }
+    }
+}
+
+CommandBuffer::CommandBuffer(std::shared_ptr<Components> components, Entities* entities) {
+    this->_components = components;
+    this->_entities = entities;
+}
+
+void CommandBuffer::despawn(Entity entity) {
+    this->_commands.push_back(Command{ CommandType::Despawn, entity, Signature{}, nullptr });
+}
+
+void CommandBuffer::append(CommandBuffer&& other) {
+    if (this == &other) {
+        return;
+    }
+
+    this->_commands.insert(this->_commands.end(), other._commands.begin(), other._commands.end());
+    this->_arena.append(std::move(other._arena));
+
+    other._commands.clear();
+}
+
+void CommandBuffer::apply(World& world) {
+    if (this->_commands.empty()) {
+        return;
+    }
+
+    // Entities reserved by spawns and other threads have to exist before commands refer to them.
+    world.entities.flush();
+
+    this->applySpawns(world);
+    this->applyTransitions(world);
+
+    this->_commands.clear();
+    this->_arena.reset();
+}
+
+void CommandBuffer::applySpawns(World& world) {
+    this->_order.clear();
+
+    for (std::size_t i = 0; i < this->_commands.size(); ++i) {
+        if (this->_commands[i].type == CommandType::Spawn) {
+            this->_order.push_back(i);
+        }
+    }
+
+    std::stable_sort(this->_order.begin(), this->_order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return signatureLess(this->_commands[lhs].bitmask, this->_commands[rhs].bitmask);
+    });
+
+    for (std::size_t begin = 0; begin < this->_order.size();) {
+        const auto& bitmask = this->_commands[this->_order[begin]].bitmask;
+
+        auto end = begin + 1;
+        while (end < this->_order.size() && this->_commands[this->_order[end]].bitmask == bitmask) {
+            end++;
+        }
+
+        const auto& edge = world.archetypes.insertEdge(Archetypes::root, bitmask & ~world.archetypes.sparseMask());
+        auto target = world.archetypes.at(edge.target);
+
+        target->reserve(end - begin);
+
+        auto firstRow = target->length();
+
+        for (auto i = begin; i < end; ++i) {
+            const auto& command = this->_commands[this->_order[i]];
+            auto entity = command.entity;
+
+            target->grow(entity, world.changeTick());
+
+            auto row = target->length() - 1;
+            world.entities.setLocation(entity, EntityLocation{ edge.target, row });
+
+            // Components are stored in id order, which is the order of the edge's bundle columns.
+            std::size_t column = 0;
+            this->forEachComponent(command, [&](component_id component, std::byte* bytes) {
+                if (auto set = world.archetypes.sparseSet(component)) {
+                    moveInto(set, entity, bytes, world.changeTick());
+                } else {
+                    moveInto(target->columnAt(edge.bundleColumns[column++]), row, bytes, false, world.changeTick());
+                }
+            });
+        }
+
+        if (world.hasHooks(ComponentEvent::Add, bitmask)) [[unlikely]] {
+            world.callHooks(ComponentEvent::Add, bitmask, std::span<const Entity>(target->entityData() + firstRow, end - begin));
+        }
+
+        begin = end;
+    }
+}
+
+void CommandBuffer::applyTransitions(World& world) {
+    this->_order.clear();
+    this->_transitions.clear();
+    this->_values.clear();
+
+    for (std::size_t i = 0; i < this->_commands.size(); ++i) {
+        if (this->_commands[i].type != CommandType::Spawn) {
+            this->_order.push_back(i);
+        }
+    }
+
+    // Stable sort keeps commands of a single entity in recording order.
+    std::stable_sort(this->_order.begin(), this->_order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return this->_commands[lhs].entity.id < this->_commands[rhs].entity.id;
+    });
+
+    const auto& sparse = world.archetypes.sparseMask();
+
+    for (std::size_t begin = 0; begin < this->_order.size();) {
+        auto id = this->_commands[this->_order[begin]].entity.id;
+
+        auto end = begin + 1;
+        while (end < this->_order.size() && this->_commands[this->_order[end]].entity.id == id) {
+            end++;
+        }
+
+        Transition transition{};
+        transition.valuesBegin = this->_values.size();
+
+        bool alive = false;
+
+        for (auto i = begin; i < end; ++i) {
+            const auto& command = this->_commands[this->_order[i]];
+
+            // Commands recorded for an older generation, or after a despawn, are dropped.
+            if (!world.entities.isAlive(command.entity) || transition.despawn) {
+                this->forEachComponent(command, [&](component_id component, std::byte* bytes) {
+                    this->destroy(component, bytes);
+                });
+                continue;
+            }
+
+            if (!alive) {
+                alive = true;
+
+                transition.entity = command.entity;
+                transition.located = !world.entities.isEmpty(command.entity);
+                transition.from = transition.located ? world.entities.getLocation(command.entity).value().archetype : Archetypes::root;
+                transition.target = world.archetypes.at(transition.from)->bitmask();
+            }
+
+            auto valuesBegin = this->_values.begin() + transition.valuesBegin;
+
+            switch (command.type) {
+                case CommandType::Insert:
+                    transition.target |= command.bitmask & ~sparse;
+
+                    this->forEachComponent(command, [&](component_id component, std::byte* bytes) {
+                        auto value = std::find_if(valuesBegin, this->_values.end(), [&](const auto& value) {
+                            return value.first == component;
+                        });
+
+                        if (value != this->_values.end()) {
+                            this->destroy(component, value->second);
+                            value->second = bytes;
+                        } else {
+                            this->_values.emplace_back(component, bytes);
+                            valuesBegin = this->_values.begin() + transition.valuesBegin;
+                        }
+                    });
+                    break;
+
+                case CommandType::Remove:
+                    transition.target &= ~command.bitmask;
+                    transition.removedSparse |= command.bitmask & sparse;
+
+                    for (auto value = valuesBegin; value != this->_values.end();) {
+                        if (command.bitmask.test(value->first)) {
+                            this->destroy(value->first, value->second);
+                            *value = this->_values.back();
+                            this->_values.pop_back();
+                        } else {
+                            ++value;
+                        }
+                    }
+                    break;
+
+                case CommandType::Despawn:
+                    transition.despawn = true;
+
+                    for (auto value = valuesBegin; value != this->_values.end(); ++value) {
+                        this->destroy(value->first, value->second);
+                    }
+                    this->_values.resize(transition.valuesBegin);
+                    break;
+
+                case CommandType::Spawn:
+                    break;
+            }
+        }
+
+        transition.valuesEnd = this->_values.size();
+
+        if (alive) {
+            this->_transitions.push_back(transition);
+        }
+
+        begin = end;
+    }
+
+    std::sort(this->_transitions.begin(), this->_transitions.end(), [](const Transition& lhs, const Transition& rhs) {
+        if (lhs.despawn != rhs.despawn) return lhs.despawn < rhs.despawn;
+        if (lhs.located != rhs.located) return lhs.located < rhs.located;
+        if (lhs.from != rhs.from) return lhs.from < rhs.from;
+        return signatureLess(lhs.target, rhs.target);
+    });
+
+    for (std::size_t begin = 0; begin < this->_transitions.size();) {
+        const auto& first = this->_transitions[begin];
+
+        auto end = begin + 1;
+        while (end < this->_transitions.size()
+            && this->_transitions[end].despawn == first.despawn
+            && this->_transitions[end].located == first.located
+            && this->_transitions[end].from == first.from
+            && this->_transitions[end].target == first.target) {
+            end++;
+        }
+
+        if (first.despawn) {
+            // Cascading relations may have despawned later entities of the group already.
+            for (auto i = begin; i < end; ++i) {
+                if (world.entities.isAlive(this->_transitions[i].entity)) {
+                    world.despawn(this->_transitions[i].entity);
+                }
+            }
+
+            begin = end;
+            continue;
+        }
+
+        const auto& edge = world.archetypes.transitionEdge(first.from, first.target);
+        auto source = first.located ? world.archetypes.at(first.from)->bitmask() : Signature{};
+        auto target = world.archetypes.at(edge.target);
+
+        if (!first.located || edge.target != first.from) {
+            target->reserve(end - begin);
+        }
+
+        // Table components are added and removed alike for the whole group, sparse ones and replaced values
+        // differ per entity.
+        auto hooked = world.hasHooks(source | first.target | sparse);
+
+        if (hooked) [[unlikely]] {
+            this->_hookEntities.clear();
+            this->_hookAdded.clear();
+
+            for (auto i = begin; i < end; ++i) {
+                this->_hookEntities.push_back(this->_transitions[i].entity);
+            }
+
+            world.callHooks(ComponentEvent::Remove, source & ~first.target, this->_hookEntities);
+
+            for (auto i = begin; i < end; ++i) {
+                const auto& transition = this->_transitions[i];
+                auto entity = std::span(&transition.entity, 1);
+
+                Signature replaced;
+                Signature added;
+
+                for (auto value = transition.valuesBegin; value < transition.valuesEnd; ++value) {
+                    auto component = this->_values[value].first;
+                    auto set = world.archetypes.sparseSet(component);
+
+                    if (set == nullptr) {
+                        if (source.test(component)) {
+                            replaced.set(component);
+                        }
+                    } else if (set->contains(transition.entity.id) && !transition.removedSparse.test(component)) {
+                        replaced.set(component);
+                    } else {
+                        added.set(component);
+                    }
+                }
+
+                world.callHooks(ComponentEvent::Remove, transition.removedSparse, entity);
+                world.callHooks(ComponentEvent::Replace, replaced, entity);
+                this->_hookAdded.push_back(added);
+            }
+        }
+
+        for (auto i = begin; i < end; ++i) {
+            const auto& transition = this->_transitions[i];
+
+            if (!transition.located) {
+                // Entities without any component stay out of the archetypes, like after spawnEmpty.
+                if (first.target.empty() && transition.valuesBegin == transition.valuesEnd) {
+                    continue;
+                }
+
+                target->grow(transition.entity, world.changeTick());
+                world.entities.setLocation(transition.entity, EntityLocation{ edge.target, target->length() - 1 });
+            } else if (edge.target != transition.from) {
+                world.archetypes.moveEntity(transition.entity, edge, &world.entities, world.changeTick());
+            }
+
+            auto row = world.entities.getLocation(transition.entity).value().row;
+
+            transition.removedSparse.forEach([&](component_id component) {
+                world.archetypes.sparseSet(component)->remove(transition.entity.id);
+            });
+
+            for (auto value = transition.valuesBegin; value < transition.valuesEnd; ++value) {
+                auto [component, bytes] = this->_values[value];
+
+                if (auto set = world.archetypes.sparseSet(component)) {
+                    moveInto(set, transition.entity, bytes, world.changeTick());
+                } else {
+                    moveInto(target->getColumn(component), row, bytes, source.test(component), world.changeTick());
+                }
+            }
+        }
+
+        if (hooked) [[unlikely]] {
+            world.callHooks(ComponentEvent::Add, first.target & ~source, this->_hookEntities);
+
+            for (auto i = begin; i < end; ++i) {
+                world.callHooks(ComponentEvent::Add, this->_hookAdded[i - begin], std::span(&this->_transitions[i].entity, 1));
+            }
+        }
+
+        begin = end;
+    }
+}
+
+void CommandBuffer::clear() {
+    for (const auto& command : this->_commands) {
+        this->forEachComponent(command, [&](component_id id, std::byte* bytes) {
+            this->destroy(id, bytes);
+        });
+    }
+
+    this->_commands.clear();
+    this->_arena.reset();
+}
+
+bool CommandBuffer::empty() const {
+    return this->_commands.empty();
+}
+
+std::size_t CommandBuffer::length() const {
+    return this->_commands.size();
+}
+
+std::size_t CommandBuffer::layoutSize(const Signature& bitmask) const {
+    std::size_t offset = 0;
+
+    bitmask.forEach([&](component_id id) {
+        auto info = this->_components->getTypeInfo(id);
+        assert(info.align <= Arena::blockAlign);
+
+        offset = (offset + info.align - 1) & ~(info.align - 1);
+        offset += info.size;
+    });
+
+    return offset;
+}
+
+std::size_t CommandBuffer::layoutOffset(const Signature& bitmask, component_id id) const {
+    std::size_t offset = 0;
+    std::size_t result = 0;
+
+    bitmask.forEach([&](component_id current) {
+        auto info = this->_components->getTypeInfo(current);
+        offset = (offset + info.align - 1) & ~(info.align - 1);
+
+        if (current == id) {
+            result = offset;
+        }
+
+        offset += info.size;
+    });
+
+    return result;
+}
+
+void CommandBuffer::destroy(component_id id, std::byte* bytes) const {
+    this->_components->getTypeInfo(id).destructor(bytes);
+}
+
+CommandBuffer& CommandBuffer::operator=(CommandBuffer&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    this->clear();
+
+    this->_components = std::move(other._components);
+    this->_entities = other._entities;
+    this->_commands = std::move(other._commands);
+    this->_arena = std::move(other._arena);
+
+    other._commands.clear();
+
+    return *this;
+}
+
+CommandBuffer::~CommandBuffer() {
+    this->clear();
+}
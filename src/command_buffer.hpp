@@ -0,0 +1,171 @@
+#pragma once
+
+#include "arena.hpp"
+#include "components.hpp"
+#include "entity.hpp"
+#include "signature.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class World;
+
+enum class CommandType : std::uint8_t {
+    Spawn,
+    Insert,
+    Remove,
+    Despawn
+};
+
+struct Command {
+    CommandType type;
+    Entity entity;
+    Signature bitmask;
+    /// Components of the command in id order, each aligned to its type. Null for removes and despawns.
+    std::byte* data;
+};
+
+/// Records structural changes without touching the world, so it can be filled while iterating. Components
+/// are moved into a linear arena and nothing is locked, so a buffer belongs to a single thread. Buffers
+/// of several threads are merged with `append` and then applied in one batch.
+class CommandBuffer {
+public:
+    /// Creates a buffer whose spawns reserve their entities in `entities`.
+    CommandBuffer(std::shared_ptr<Components> components, Entities* entities);
+
+    /// Records the spawn of an entity and returns its handle, reserved right away so further commands can
+    /// target it. The entity stays alive without components when the buffer is cleared instead of applied.
+    template<typename... Comps>
+    Entity spawn(Comps&&... components) {
+        Command command{ CommandType::Spawn, this->_entities->reserve(), Signature{}, nullptr };
+        command.data = this->store(command.bitmask, std::forward<Comps>(components)...);
+
+        this->_commands.push_back(command);
+        return command.entity;
+    }
+
+    template<typename... Comps>
+    void insert(Entity entity, Comps&&... components) {
+        Command command{ CommandType::Insert, entity, Signature{}, nullptr };
+        command.data = this->store(command.bitmask, std::forward<Comps>(components)...);
+
+        this->_commands.push_back(command);
+    }
+
+    template<typename... Comps>
+    void remove(Entity entity) {
+        Command command{ CommandType::Remove, entity, Signature{}, nullptr };
+        (..., command.bitmask.set(this->_components->getId<std::decay_t<Comps>>()));
+
+        this->_commands.push_back(command);
+    }
+
+    void despawn(Entity entity);
+
+    /// Moves commands of the other buffer behind the commands of this one.
+    void append(CommandBuffer&& other);
+
+    /// Applies every command to the world and clears the buffer. Commands of one entity are folded into a
+    /// single transition, and entities taking the same transition are moved as a group, so every group
+    /// resolves its archetype edge and reserves its rows once.
+    void apply(World& world);
+
+    /// Drops every recorded command, destroying the components they carry.
+    void clear();
+
+    bool empty() const;
+    std::size_t length() const;
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    CommandBuffer(CommandBuffer&&) noexcept = default;
+    CommandBuffer& operator=(CommandBuffer&& other) noexcept;
+
+    ~CommandBuffer();
+
+private:
+    /// Entity's commands folded into one transition.
+    struct Transition {
+        Entity entity;
+        std::size_t from;
+        bool located;
+        bool despawn;
+        /// Table components of the target archetype. Sparse components stay out of it.
+        Signature target;
+        /// Sparse components removed from the entity, before its values are inserted.
+        Signature removedSparse;
+        std::size_t valuesBegin;
+        std::size_t valuesEnd;
+    };
+
+    template<typename... Comps>
+    std::byte* store(Signature& bitmask, Comps&&... components) {
+        (..., bitmask.set(this->_components->getId<std::decay_t<Comps>>()));
+        assert(bitmask.count() == sizeof...(Comps) && "Command contains the same component twice");
+
+        auto data = this->_arena.allocate(this->layoutSize(bitmask), Arena::blockAlign);
+
+        (..., [&]() {
+            using Component = std::decay_t<Comps>;
+
+            // Tags take no room in the layout, so nothing is constructed for them.
+            if constexpr (!std::is_empty_v<Component>) {
+                new (data + this->layoutOffset(bitmask, this->_components->getId<Component>()))
+                    Component(std::forward<Comps>(components));
+            }
+        }());
+
+        return data;
+    }
+
+    std::size_t layoutSize(const Signature& bitmask) const;
+    std::size_t layoutOffset(const Signature& bitmask, component_id id) const;
+
+    /// Calls the function with the id and bytes of every component carried by the command. Tags carry no
+    /// bytes and are skipped.
+    template<typename Func>
+    void forEachComponent(const Command& command, Func&& func) const {
+        if (command.data == nullptr) {
+            return;
+        }
+
+        std::size_t offset = 0;
+
+        command.bitmask.forEach([&](component_id id) {
+            auto info = this->_components->getTypeInfo(id);
+
+            if (info.size == 0) {
+                return;
+            }
+            offset = (offset + info.align - 1) & ~(info.align - 1);
+
+            func(id, command.data + offset);
+
+            offset += info.size;
+        });
+    }
+
+    void destroy(component_id id, std::byte* bytes) const;
+    void applySpawns(World& world);
+    void applyTransitions(World& world);
+
+    std::shared_ptr<Components> _components;
+    Entities* _entities;
+    std::vector<Command> _commands;
+    Arena _arena;
+
+    // Scratch space of `apply`, kept to avoid allocating on every flush.
+    std::vector<std::size_t> _order;
+    std::vector<Transition> _transitions;
+    std::vector<std::pair<component_id, std::byte*>> _values;
+    std::vector<std::size_t> _columns;
+    /// Entities of a transition group and the sparse components each gains, for hooks.
+    std::vector<Entity> _hookEntities;
+    std::vector<Signature> _hookAdded;
+};
@@ -1,52 +1,88 @@
 #pragma once
 
 #include "blob_vector.hpp"
+#include "signature.hpp"
 
+#include <atomic>
 #include <cstdint>
-#include <typeindex>
-#include <unordered_map>
-
-using component_id = std::uint64_t;
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/// Address handed out for tags. They have no storage, so every tag of every entity shares it.
+inline std::byte* tagAddress() {
+    alignas(BlobVector::bufferAlign) static std::byte storage[1];
+    return storage;
+}
+
+/// Where a component lives. Table components are columns of the archetypes. Sparse components are kept in a
+/// sparse set per component, outside archetype signatures, so inserting or removing them moves no rows.
+enum class StorageType : std::uint8_t {
+    Table,
+    Sparse,
+};
 
 class Components {
 public:
     template<typename T>
-    component_id registerComponent() {
-        auto typeIdx = std::type_index(typeid(T));
+    component_id registerComponent(StorageType storage = StorageType::Table) {
+        auto slot = typeSlot<T>();
 
-        assert(_componentMap.find(typeIdx) == _componentMap.end());
+        if (slot >= _typeIds.size()) {
+            _typeIds.resize(slot + 1, unregistered);
+        }
 
-        component_id id = nextId();
-        TypeInfo info = TypeInfo::Of<T>();
+        assert(_typeIds[slot] == unregistered);
 
-        _componentMap[typeIdx] = id;
-        _types[id] = info;
+        component_id id = this->registerComponent(TypeInfo::Of<T>(), storage);
+        _typeIds[slot] = id;
 
         return id;
     }
 
-    component_id registerComponent(TypeInfo typeInfo) {
+    /// Throws when every id a Signature can hold is taken.
+    component_id registerComponent(TypeInfo typeInfo, StorageType storage = StorageType::Table) {
         component_id id = nextId();
 
-        _types[id] = typeInfo;
+        assert((typeInfo.size > 0 || storage == StorageType::Table) && "Tags can't use sparse storage");
+
+        _types.push_back(typeInfo);
+        _storages.push_back(storage);
+
+        if (storage == StorageType::Sparse) {
+            _sparse.set(id);
+        }
+
+        if (typeInfo.size == 0) {
+            _tags.set(id);
+        }
+
         return id;
     }
 
+    /// Returns the id of a registered type. After the first call per type this is two loads, no hashing.
     template<typename T>
     component_id getId() const {
-        auto it = _componentMap.find(std::type_index(typeid(T)));
+        auto slot = typeSlot<T>();
 
-        assert(it != _componentMap.end() && "Component type is not registered!");
-        return it->second;
+        assert(slot < _typeIds.size() && _typeIds[slot] != unregistered && "Component type is not registered!");
+        return _typeIds[slot];
     }
 
     template<typename T>
     bool isRegistered() const {
-        return _componentMap.find(std::type_index(typeid(T))) != _componentMap.end();
+        auto slot = typeSlot<T>();
+        return slot < _typeIds.size() && _typeIds[slot] != unregistered;
     }
 
     bool isRegistered(component_id id) const {
-        return _types.find(id) != _types.end();
+        return id < _types.size();
+    }
+
+    /// Returns the number of registered components, whose ids are every id below it.
+    std::size_t count() const {
+        return _types.size();
     }
 
     template<typename T>
@@ -55,22 +91,58 @@ public:
     }
 
     TypeInfo getTypeInfo(component_id id) const {
-        auto it = _types.find(id);
+        assert(isRegistered(id));
+        return _types[id];
+    }
 
-        assert(it != _types.end());
-        return it->second;
+    StorageType getStorageType(component_id id) const {
+        assert(isRegistered(id));
+        return _storages[id];
+    }
+
+    /// Returns every component registered with sparse storage.
+    const Signature& sparse() const {
+        return _sparse;
+    }
+
+    /// Returns every tag, the components of size zero. Tags have no columns and carry no data.
+    const Signature& tags() const {
+        return _tags;
     }
 
 private:
+    static constexpr component_id unregistered = std::numeric_limits<component_id>::max();
+
+    /// Returns a process-wide unique slot of the C++ type, shared by every world. Each world maps slots to
+    /// its own component ids. Like typeid, cv-qualifiers are ignored.
+    template<typename T>
+    static std::size_t typeSlot() {
+        if constexpr (!std::is_same_v<T, std::remove_cv_t<T>>) {
+            return typeSlot<std::remove_cv_t<T>>();
+        } else {
+            static const std::size_t slot = nextTypeSlot();
+            return slot;
+        }
+    }
+
+    static std::size_t nextTypeSlot() {
+        static std::atomic<std::size_t> slot = 0;
+        return slot.fetch_add(1, std::memory_order_relaxed);
+    }
+
     component_id nextId() {
-        assert(_nextId != 0);
+        // Signatures can't hold more, setting a bit past them would write out of bounds.
+        if (_types.size() == Signature::capacity) {
+            throw std::runtime_error("Too many components, raise WECS_MAX_COMPONENTS");
+        }
 
-        component_id id = _nextId;
-        _nextId <<= 1;
-        return id;
+        return component_id(_types.size());
     }
 
-    std::unordered_map<component_id, TypeInfo> _types;
-    std::unordered_map<std::type_index, component_id> _componentMap;
-    component_id _nextId = 1;
+    std::vector<TypeInfo> _types;
+    std::vector<StorageType> _storages;
+    Signature _sparse;
+    Signature _tags;
+    /// Component id of every type slot, `unregistered` for types this world doesn't know.
+    std::vector<component_id> _typeIds;
 };
@@ -0,0 +1,440 @@
+#include "delta.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr char deltaMagic[4] = {'W', 'D', 'L', 'T'};
+
+    enum class DeltaOp : std::uint8_t {
+        /// Entities to despawn.
+        Despawn,
+        /// Entities to put in an archetype, followed by their rows column by column. Spawned entities are
+        /// created under the same handle first, moved ones leave their current row.
+        Place,
+        /// Entities without components, spawned or having lost their row.
+        Clear,
+        /// Bytes of a component changed on entities that stayed in their archetype.
+        Change,
+        /// Every row of a sparse set, replacing its contents.
+        Sparse,
+        /// The pair registry, replacing the mirror's. Comes first, so ids of new pairs are registered before
+        /// records use them, and despawns find no pair left to clean up.
+        Pairs,
+    };
+
+    template<typename T>
+    void put(std::vector<std::byte>& out, const T& value) {
+        auto bytes = reinterpret_cast<const std::byte*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void putArray(std::vector<std::byte>& out, const T* values, std::size_t count) {
+        auto bytes = reinterpret_cast<const std::byte*>(values);
+        out.insert(out.end(), bytes, bytes + count * sizeof(T));
+    }
+
+    /// Reads a delta. Values aren't aligned in the stream, so they are copied out.
+    class DeltaReader {
+    public:
+        explicit DeltaReader(std::span<const std::byte> delta) : _delta(delta) {}
+
+        template<typename T>
+        T take() {
+            T value;
+            std::memcpy(&value, this->bytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void takeArray(std::vector<T>& out, std::size_t count) {
+            out.resize(count);
+            auto bytes = this->bytes(count * sizeof(T));
+
+            if (count > 0) {
+                std::memcpy(out.data(), bytes, count * sizeof(T));
+            }
+        }
+
+        const std::byte* bytes(std::size_t count) {
+            if (count > this->_delta.size() - this->_offset) {
+                throw std::runtime_error("Delta is truncated");
+            }
+
+            auto bytes = this->_delta.data() + this->_offset;
+            this->_offset += count;
+            return bytes;
+        }
+
+        bool done() const {
+            return this->_offset == this->_delta.size();
+        }
+
+    private:
+        std::span<const std::byte> _delta;
+        std::size_t _offset = 0;
+    };
+
+    void checkSendable(const BlobVector& column) {
+        if (!column.typeInfo().trivially_relocatable) {
+            throw std::runtime_error("Deltas can only send trivially copyable components");
+        }
+    }
+
+    /// Writes a record of entities, which is all there is to Despawn and Clear records.
+    void putEntities(std::vector<std::byte>& out, DeltaOp op, const std::vector<Entity>& entities) {
+        put(out, op);
+        put(out, std::uint32_t(entities.size()));
+        putArray(out, entities.data(), entities.size());
+    }
+}
+
+void DeltaEncoder::encode(World& world, std::vector<std::byte>& out) {
+    world.entities.flush();
+
+    world.checkChangeTicks();
+
+    auto thisRun = world.incrementChangeTick();
+    auto& archetypes = world.archetypes;
+    auto& components = *world.components;
+    this->_lastRun = clampTick(this->_lastRun, thisRun);
+
+    auto generations = world.entities.generationData();
+    auto locations = world.entities.archetypeData();
+    auto rows = world.entities.rowData();
+    auto count = generations.size();
+    auto archetypeCount = archetypes.length();
+
+    this->_alive.assign(count, 1);
+    for (auto id : world.entities.freeData()) {
+        this->_alive[id] = 0;
+    }
+
+    this->_generations.resize(count, 0);
+    this->_archetypes.resize(count, dead);
+    this->_placed.assign(count, 0);
+
+    // One list per archetype, and a last one for entities without a location.
+    this->_spawned.resize(archetypeCount + 1);
+    this->_moved.resize(archetypeCount + 1);
+    for (std::size_t i = 0; i <= archetypeCount; ++i) {
+        this->_spawned[i].clear();
+        this->_moved[i].clear();
+    }
+
+    std::vector<Entity>& despawned = this->_entities;
+    despawned.clear();
+
+    for (std::size_t id = 0; id < count; ++id) {
+        auto wasAlive = this->_archetypes[id] != dead;
+        auto alive = this->_alive[id] != 0;
+        auto same = wasAlive && alive && this->_generations[id] == generations[id];
+
+        if (wasAlive && !same) {
+            despawned.push_back(Entity{EntityId(id), this->_generations[id]});
+        }
+
+        if (alive && (!same || this->_archetypes[id] != locations[id])) {
+            auto list = std::min<std::size_t>(locations[id], archetypeCount);
+            (same ? this->_moved : this->_spawned)[list].push_back(Entity{EntityId(id), generations[id]});
+            this->_placed[id] = 1;
+        }
+
+        this->_generations[id] = generations[id];
+        this->_archetypes[id] = alive ? locations[id] : dead;
+    }
+
+    put(out, deltaMagic);
+    put(out, deltaVersion);
+    put(out, std::uint32_t(components.count()));
+
+    if (world.relations.version() != this->_relationsVersion) {
+        auto pairs = world.relations.pairData();
+        auto free = world.relations.freeData();
+
+        put(out, DeltaOp::Pairs);
+        put(out, std::uint32_t(pairs.size()));
+        putArray(out, pairs.data(), pairs.size());
+        put(out, std::uint32_t(free.size()));
+        putArray(out, free.data(), free.size());
+
+        this->_relationsVersion = world.relations.version();
+    }
+
+    if (!despawned.empty()) {
+        putEntities(out, DeltaOp::Despawn, despawned);
+    }
+
+    for (auto* lists : {&this->_spawned, &this->_moved}) {
+        std::uint8_t spawned = lists == &this->_spawned;
+        auto& unlocated = (*lists)[archetypeCount];
+
+        if (!unlocated.empty()) {
+            putEntities(out, DeltaOp::Clear, unlocated);
+            put(out, spawned);
+        }
+
+        for (std::size_t index = 0; index < archetypeCount; ++index) {
+            auto& entities = (*lists)[index];
+
+            if (entities.empty()) {
+                continue;
+            }
+
+            auto archetype = archetypes.at(index);
+            put(out, DeltaOp::Place);
+            put(out, spawned);
+            put(out, archetype->bitmask());
+            put(out, std::uint32_t(entities.size()));
+            putArray(out, entities.data(), entities.size());
+
+            for (std::size_t i = 0; i < archetype->columnCount(); ++i) {
+                auto column = archetype->columnAt(i);
+                auto size = column->typeInfo().size;
+                checkSendable(*column);
+
+                for (auto entity : entities) {
+                    putArray(out, column->get(rows[entity.id]), size);
+                }
+            }
+        }
+    }
+
+    // Rows that were placed are sent whole already. Everything else is only sent where it changed, and the
+    // first call placed every row.
+    for (std::size_t index = 0; index < archetypeCount && this->_started; ++index) {
+        auto archetype = archetypes.at(index);
+        auto length = archetype->length();
+        auto chunkRows = archetype->chunkRows();
+        auto entities = archetype->entityData();
+
+        if (length == 0) {
+            continue;
+        }
+
+        (archetype->bitmask() & ~components.tags()).forEach([&](component_id id) {
+            auto column = archetype->getColumn(id);
+            auto size = column->typeInfo().size;
+            auto changed = column->changedTicks();
+
+            this->_entities.clear();
+            this->_bytes.clear();
+
+            for (std::size_t page = 0; page < archetype->chunkCount(); ++page) {
+                auto ticks = column->pageTicks(page);
+
+                if (!isNewerTick(ticks->latest, this->_lastRun, thisRun)) {
+                    continue;
+                }
+
+                auto bulk = ticks->hasBulk && isNewerTick(ticks->bulk, this->_lastRun, thisRun);
+                auto end = std::min(length, (page + 1) * chunkRows);
+
+                for (auto row = page * chunkRows; row < end; ++row) {
+                    if ((bulk || isNewerTick(changed[row], this->_lastRun, thisRun)) && !this->_placed[entities[row].id]) {
+                        this->_entities.push_back(entities[row]);
+                        putArray(this->_bytes, column->get(row), size);
+                    }
+                }
+            }
+
+            if (this->_entities.empty()) {
+                return;
+            }
+
+            checkSendable(*column);
+            put(out, DeltaOp::Change);
+            put(out, std::uint32_t(id));
+            put(out, std::uint32_t(this->_entities.size()));
+            putArray(out, this->_entities.data(), this->_entities.size());
+            putArray(out, this->_bytes.data(), this->_bytes.size());
+        });
+    }
+
+    this->_sparseEntities.resize(components.count());
+
+    components.sparse().forEach([&](component_id id) {
+        auto set = archetypes.sparseSet(id);
+        auto& dense = set->dense();
+        auto& previous = this->_sparseEntities[id];
+
+        auto changed = previous != set->entities();
+        auto recent = this->_started && isNewerTick(dense.pageTicks(0)->latest, this->_lastRun, thisRun);
+
+        for (std::size_t row = 0; row < set->length() && !changed && recent; ++row) {
+            auto ticks = dense.ticks(row);
+            changed = isNewerTick(ticks.changed, this->_lastRun, thisRun);
+        }
+
+        if (!changed) {
+            return;
+        }
+
+        checkSendable(dense);
+        put(out, DeltaOp::Sparse);
+        put(out, std::uint32_t(id));
+        put(out, std::uint32_t(set->length()));
+        putArray(out, set->entities().data(), set->length());
+        if (set->length() > 0) {
+            putArray(out, dense.get(0), set->length() * dense.typeInfo().size);
+        }
+
+        previous = set->entities();
+    });
+
+    this->_lastRun = thisRun;
+    this->_started = true;
+}
+
+void applyDelta(World& world, std::span<const std::byte> delta) {
+    DeltaReader reader(delta);
+
+    auto magic = reader.take<std::array<char, 4>>();
+    auto version = reader.take<std::uint32_t>();
+    auto componentCount = reader.take<std::uint32_t>();
+
+    if (std::memcmp(magic.data(), deltaMagic, sizeof(deltaMagic)) != 0 || version != deltaVersion) {
+        throw std::runtime_error("Not a delta of this version");
+    }
+
+    auto& archetypes = world.archetypes;
+    auto& entities = world.entities;
+
+    // Checked once the pair registry, which may register components, was applied.
+    auto checked = false;
+    auto checkComponents = [&]() {
+        if (componentCount != world.components->count()) {
+            throw std::runtime_error("Delta components don't match the world's");
+        }
+
+        checked = true;
+    };
+
+    auto tick = world.changeTick();
+    std::vector<Entity> batch;
+
+    // Spawned entities take their handle, moved ones drop their old row. Either way they end up alive
+    // without a location. Entities come in id order, and so do ids freed by despawn records, so claiming
+    // from the last one finds every id at the back of the free list.
+    auto unplace = [&](bool spawned) {
+        for (auto entity = batch.rbegin(); entity != batch.rend(); ++entity) {
+            if (spawned) {
+                entities.claim(*entity);
+            } else if (!entities.isEmpty(*entity)) {
+                archetypes.removeEntity(*entity, &entities);
+            }
+        }
+    };
+
+    while (!reader.done()) {
+        auto op = reader.take<DeltaOp>();
+
+        if (op != DeltaOp::Pairs && !checked) {
+            checkComponents();
+        }
+
+        switch (op) {
+            case DeltaOp::Pairs: {
+                if (checked) {
+                    throw std::runtime_error("Delta is corrupted");
+                }
+
+                std::vector<RelationPair> pairs;
+                std::vector<component_id> free;
+                reader.takeArray(pairs, reader.take<std::uint32_t>());
+                reader.takeArray(free, reader.take<std::uint32_t>());
+
+                world.restorePairs(pairs, free);
+                checkComponents();
+                break;
+            }
+            case DeltaOp::Despawn: {
+                reader.takeArray(batch, reader.take<std::uint32_t>());
+
+                for (auto entity : batch) {
+                    world.despawn(entity);
+                }
+                break;
+            }
+            case DeltaOp::Clear: {
+                reader.takeArray(batch, reader.take<std::uint32_t>());
+                unplace(reader.take<std::uint8_t>() != 0);
+                break;
+            }
+            case DeltaOp::Place: {
+                auto spawned = reader.take<std::uint8_t>() != 0;
+                auto bitmask = reader.take<Signature>();
+                reader.takeArray(batch, reader.take<std::uint32_t>());
+                unplace(spawned);
+
+                auto archetype = archetypes.getOrCreate(bitmask);
+                auto index = archetypes.position(bitmask);
+                auto first = archetype->length();
+
+                archetype->growBatch(batch.data(), batch.size(), tick);
+
+                for (std::size_t i = 0; i < archetype->columnCount(); ++i) {
+                    auto column = archetype->columnAt(i);
+                    auto size = column->typeInfo().size;
+                    auto bytes = reader.bytes(batch.size() * size);
+
+                    column->forEachRange(first, batch.size(), [&](std::byte* ptr, std::size_t count) {
+                        std::memcpy(ptr, bytes, count * size);
+                        bytes += count * size;
+                    });
+                }
+
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    entities.setLocation(batch[i], EntityLocation{index, first + i});
+                }
+                break;
+            }
+            case DeltaOp::Change: {
+                auto id = component_id(reader.take<std::uint32_t>());
+                reader.takeArray(batch, reader.take<std::uint32_t>());
+
+                for (auto entity : batch) {
+                    auto location = entities.getLocation(entity);
+                    auto column = location ? archetypes.at(location->archetype)->getColumn(id) : nullptr;
+
+                    if (!column) {
+                        throw std::runtime_error("Delta changes a component the entity doesn't have");
+                    }
+
+                    auto size = column->typeInfo().size;
+                    std::memcpy(column->get(location->row), reader.bytes(size), size);
+                    column->markChanged(location->row, 1, tick);
+                }
+                break;
+            }
+            case DeltaOp::Sparse: {
+                auto id = reader.take<std::uint32_t>();
+                auto set = id < componentCount ? archetypes.sparseSet(component_id(id)) : nullptr;
+                reader.takeArray(batch, reader.take<std::uint32_t>());
+
+                if (!set) {
+                    throw std::runtime_error("Delta components don't match the world's");
+                }
+
+                auto size = set->dense().typeInfo().size;
+                auto bytes = reader.bytes(batch.size() * size);
+                set->clear();
+
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    set->insert(batch[i], const_cast<std::byte*>(bytes + i * size), tick);
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Delta is corrupted");
+        }
+    }
+
+    if (!checked) {
+        checkComponents();
+    }
+}
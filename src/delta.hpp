@@ -0,0 +1,56 @@
+#pragma once
+
+#include "entity.hpp"
+#include "tick.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class World;
+
+/// Version of the delta format, bumped whenever the layout changes. Deltas of other versions are rejected.
+constexpr std::uint32_t deltaVersion = 2;
+
+/// Encodes how a world changes between calls into compact deltas, to replicate it to mirrors or keep a
+/// rollback history. A delta holds despawned entities, entities spawned or moved to another archetype with
+/// their whole row, the components changed since the previous call, and sparse sets that changed, which are
+/// sent whole. Components are sent as raw bytes and must be trivially copyable. An encoder follows a single
+/// world from its first call on. The relationship pair registry is sent whole whenever it changed, so
+/// mirrors register pair ids the way the encoded world did.
+class DeltaEncoder {
+public:
+    /// Appends the delta since the previous call to `out`, or the whole world on the first call. Changes are
+    /// found through change ticks like a query with a `Changed` filter does, so whole pages without changes
+    /// are skipped. Entity metadata is compared with the previous call's. Throws when a component to send
+    /// isn't trivially relocatable.
+    void encode(World& world, std::vector<std::byte>& out);
+
+private:
+    /// Archetype of ids that weren't alive at the previous call.
+    static constexpr std::uint32_t dead = std::uint32_t(-2);
+
+    // Generation and archetype of every entity id at the previous call.
+    std::vector<EntityGeneration> _generations;
+    std::vector<std::uint32_t> _archetypes;
+    /// Entities of every sparse set at the previous call, indexed by component id.
+    std::vector<std::vector<Entity>> _sparseEntities;
+    /// Version of the pair registry at the previous call.
+    std::uint64_t _relationsVersion = 0;
+    Tick _lastRun = 0;
+    bool _started = false;
+
+    // Scratch space kept between calls, so encoding a tick doesn't allocate once the world stops growing.
+    std::vector<std::uint8_t> _alive;
+    std::vector<std::uint8_t> _placed;
+    std::vector<std::vector<Entity>> _spawned;
+    std::vector<std::vector<Entity>> _moved;
+    std::vector<Entity> _entities;
+    std::vector<std::byte> _bytes;
+};
+
+/// Applies a delta to a world mirroring the encoder's, whose components and relations were registered in the
+/// same order. Pair ids arrive with the delta. Entities keep the handles they have in the encoded world. Spawned and moved rows are placed in batch, a
+/// single grow per archetype and a copy per column. Throws when the delta doesn't fit the world.
+void applyDelta(World& world, std::span<const std::byte> delta);
@@ -1,40 +1,169 @@
 #include "entity.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <print>
 
 Entity Entities::create() {
+    this->flush();
+
     if (!this->free.empty()) {
         auto index = this->free.back();
-        auto meta = this->entities[index];
         this->free.pop_back();
-        return Entity{index, meta.generation};
+        this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
+        return Entity{index, this->generations[index]};
+    }
+
+    this->grow(1);
+
+    return Entity{EntityId(this->generations.size() - 1), 0};
+}
+
+void Entities::createBatch(std::size_t count, Entity* out) {
+    this->flush();
+
+    auto reused = std::min(count, this->free.size());
+
+    for (std::size_t i = 0; i < reused; ++i) {
+        auto index = this->free.back();
+        this->free.pop_back();
+        out[i] = Entity{index, this->generations[index]};
+    }
+
+    this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
+
+    auto first = this->generations.size();
+    this->grow(count - reused);
+
+    for (std::size_t i = reused; i < count; ++i) {
+        out[i] = Entity{EntityId(first + i - reused), 0};
     }
+}
 
-    this->entities.emplace_back<EntityMeta>({0, {}});
+Entity Entities::reserve() {
+    auto cursor = this->freeCursor.fetch_sub(1, std::memory_order_relaxed);
+
+    if (cursor > 0) {
+        auto index = this->free[std::size_t(cursor - 1)];
+        return Entity{index, this->generations[index]};
+    }
 
-    return Entity{this->entities.size() - 1, 0};
+    return Entity{EntityId(this->generations.size() + std::size_t(-cursor)), 0};
+}
+
+void Entities::flush() {
+    auto cursor = this->freeCursor.load(std::memory_order_relaxed);
+
+    if (cursor == std::int64_t(this->free.size())) {
+        return;
+    }
+
+    // Reserved free ids keep their generation, new ones start at zero, and all of them have no location.
+    if (cursor < 0) {
+        this->free.clear();
+        this->grow(std::size_t(-cursor));
+    } else {
+        this->free.resize(std::size_t(cursor));
+    }
+
+    this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
+}
+
+void Entities::grow(std::size_t count) {
+    auto size = this->generations.size() + count;
+    assert(size <= std::numeric_limits<EntityId>::max() && "Too many entities for 32-bit ids");
+
+    this->generations.resize(size, 0);
+    this->archetypes.resize(size, noArchetype);
+    this->rows.resize(size, 0);
+}
+
+void Entities::claim(Entity entity) {
+    this->flush();
+
+    if (entity.id >= this->generations.size()) {
+        auto first = this->generations.size();
+        this->grow(entity.id + 1 - first);
+
+        for (auto id = EntityId(entity.id); id > first; --id) {
+            this->free.push_back(id - 1);
+        }
+    } else {
+        auto it = std::find(this->free.rbegin(), this->free.rend(), entity.id);
+        assert(it != this->free.rend() && "Claimed entity is alive");
+
+        *it = this->free.back();
+        this->free.pop_back();
+    }
+
+    this->generations[entity.id] = entity.generation;
+    this->archetypes[entity.id] = noArchetype;
+    this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
 }
 
 void Entities::setLocation(Entity entity, EntityLocation location) {
-    auto& meta = this->entities[entity.id];
+    assert(location.archetype < noArchetype && location.row <= std::numeric_limits<std::uint32_t>::max());
+
+    this->archetypes[entity.id] = std::uint32_t(location.archetype);
+    this->rows[entity.id] = std::uint32_t(location.row);
+}
 
-    meta.location = location;
+void Entities::clearLocation(Entity entity) {
+    this->archetypes[entity.id] = noArchetype;
 }
 
 void Entities::despawn(Entity entity) {
-    auto& meta = this->entities[entity.id];
-    meta.generation++;
+    this->flush();
+
+    this->generations[entity.id]++;
+    this->archetypes[entity.id] = noArchetype;
     this->free.emplace_back(entity.id);
+    this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
 }
 
 bool Entities::isEmpty(Entity entity) const {
-    return !this->entities[entity.id].location.has_value();
+    return entity.id >= this->archetypes.size() || this->archetypes[entity.id] == noArchetype;
 }
 
 bool Entities::isAlive(Entity entity) const {
-    return this->entities[entity.id].generation == entity.generation;
+    return entity.id < this->generations.size() && this->generations[entity.id] == entity.generation;
 }
 
 std::optional<EntityLocation> Entities::getLocation(Entity entity) const {
-    return this->entities[entity.id].location;
+    if (this->isEmpty(entity)) {
+        return std::nullopt;
+    }
+
+    return EntityLocation{this->archetypes[entity.id], this->rows[entity.id]};
+}
+
+std::span<const EntityGeneration> Entities::generationData() const {
+    return this->generations;
+}
+
+std::span<const std::uint32_t> Entities::archetypeData() const {
+    return this->archetypes;
+}
+
+std::span<const std::uint32_t> Entities::rowData() const {
+    return this->rows;
+}
+
+std::span<const EntityId> Entities::freeData() const {
+    return this->free;
+}
+
+void Entities::restore(
+    std::span<const EntityGeneration> generations,
+    std::span<const std::uint32_t> archetypes,
+    std::span<const std::uint32_t> rows,
+    std::span<const EntityId> free
+) {
+    assert(archetypes.size() == generations.size() && rows.size() == generations.size());
+
+    this->generations.assign(generations.begin(), generations.end());
+    this->archetypes.assign(archetypes.begin(), archetypes.end());
+    this->rows.assign(rows.begin(), rows.end());
+    this->free.assign(free.begin(), free.end());
+    this->freeCursor.store(std::int64_t(this->free.size()), std::memory_order_relaxed);
 }
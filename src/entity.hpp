@@ -1,40 +1,95 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <optional>
+#include <span>
 #include <vector>
 
-using EntityId = std::size_t;
-using EntityGeneration = std::uint16_t;
+using EntityId = std::uint32_t;
+using EntityGeneration = std::uint32_t;
 
+/// Handle of an entity, packed into 64 bits: the index into the entity metadata, then the generation that
+/// tells reused indices apart. The layout is part of the FFI.
 struct Entity {
     EntityId id;
     EntityGeneration generation;
+
+    bool operator==(const Entity&) const = default;
 };
 
+static_assert(sizeof(Entity) == sizeof(std::uint64_t), "Entity must stay a packed 64-bit handle");
+
 struct EntityLocation {
     std::size_t archetype;
     std::size_t row;
 };
 
-struct EntityMeta {
-    EntityGeneration generation;
-    std::optional<EntityLocation> location;
-};
-
+/// Metadata of every entity, kept as parallel arrays so checking a generation or a location only touches
+/// the 4 bytes it needs.
 class Entities {
 public:
+    Entities() = default;
+
+    Entities(const Entities&) = delete;
+    Entities& operator=(const Entities&) = delete;
+
     Entity create();
+    /// Creates `count` entities, reusing free ids first and taking the rest as one block.
+    void createBatch(std::size_t count, Entity* out);
+
+    /// Reserves an entity without touching the metadata, so it is safe to call from any number of threads
+    /// while nothing else changes the entities. The handle can be recorded in command buffers right away,
+    /// but the entity only exists, alive and without components, after the next `flush`.
+    Entity reserve();
+
+    /// Turns every reserved entity into a live one. Called at sync points, and by every other method that
+    /// changes the entities.
+    void flush();
+
+    /// Makes the entity alive, without a location, under exactly the given handle. Its id must not be alive.
+    /// Used to mirror another world's entities, ids skipped on the way become free. Finding the id in the
+    /// free list searches it from the back, where recently despawned ids are.
+    void claim(Entity entity);
 
     void setLocation(Entity entity, EntityLocation location);
+    void clearLocation(Entity entity);
     void despawn(Entity entity);
 
+    /// Ids reserved past the arrays aren't alive and have no location until the next flush.
     bool isEmpty(Entity entity) const;
     bool isAlive(Entity entity) const;
     std::optional<EntityLocation> getLocation(Entity entity) const;
 
+    /// Metadata arrays indexed by entity id, and the free list. Snapshots store them as they are.
+    std::span<const EntityGeneration> generationData() const;
+    std::span<const std::uint32_t> archetypeData() const;
+    std::span<const std::uint32_t> rowData() const;
+    std::span<const EntityId> freeData() const;
+
+    /// Replaces every entity with the given metadata, dropping reservations. The arrays must be as long
+    /// as each other.
+    void restore(
+        std::span<const EntityGeneration> generations,
+        std::span<const std::uint32_t> archetypes,
+        std::span<const std::uint32_t> rows,
+        std::span<const EntityId> free
+    );
+
 private:
-    std::vector<EntityMeta> entities;
-    std::vector<std::size_t> free;
+    /// Archetype of entities without a location.
+    static constexpr std::uint32_t noArchetype = std::numeric_limits<std::uint32_t>::max();
+
+    /// Appends metadata of `count` new entities without a location.
+    void grow(std::size_t count);
+
+    std::vector<EntityGeneration> generations;
+    std::vector<std::uint32_t> archetypes;
+    std::vector<std::uint32_t> rows;
+    std::vector<EntityId> free;
+    /// Number of free ids not reserved yet. Reservations take ids from the back of `free` and push the
+    /// cursor below zero once it runs out, each negative step standing for a new id past the metadata.
+    std::atomic<std::int64_t> freeCursor = 0;
 };
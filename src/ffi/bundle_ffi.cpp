@@ -1,8 +1,10 @@
 #include "../world.hpp"
 
 extern "C" {
-    Bundle* _BundleCreate(World* world, component_id bitmask, std::byte* buffer, std::size_t count) {
-        return std::make_unique<Bundle>(world->components, bitmask, buffer, count, false).release();
+    /// Creates a heap bundle over the caller's buffer, which holds `count` components in id order without
+    /// padding. Prefer _WorldSpawnBuffer and _WorldInsertBuffer, which don't allocate.
+    Bundle* _BundleCreate(World* world, const Signature* bitmask, std::byte* buffer, std::size_t count) {
+        return std::make_unique<Bundle>(world->components.get(), *bitmask, buffer, count).release();
     }
 
     void _BundleDestroy(Bundle* bundle) {
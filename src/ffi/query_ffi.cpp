@@ -1,18 +1,116 @@
 #include "../query.hpp"
 #include "../world.hpp"
 
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/// Column of a chunk as foreign callers see it: only the data pointer, null for optional components the
+/// chunk lacks. Ticks stay internal, see _QueryMarkChanged.
+struct FfiQueryColumn {
+    std::byte* data;
+};
+
+struct FfiQueryChunk {
+    FfiQueryColumn* columns;
+    Entity* entities;
+    std::size_t entityCount;
+};
+
+/// Query handle of the FFI. Chunks are mirrored from the query's own after every fetch, so their layout
+/// doesn't change when QueryColumn grows.
+struct FfiQuery {
+    Query query;
+    std::vector<FfiQueryColumn> columns;
+    std::vector<FfiQueryChunk> chunks;
+};
+
+/// Returned by fetches asking for sparse components. Exceptions can't unwind into foreign callers.
+static constexpr int SparseFetchError = -1;
+
+/// Sparse components live in sets indexed by set row instead of chunk row, which chunk data can't express.
+static bool canFetch(World* world, const Signature& fetch) {
+    return !fetch.intersects(world->archetypes.sparseMask());
+}
+
+static int mirrorChunks(FfiQuery* query, FfiQueryChunk** outChunks) {
+    const auto termCount = query->query.fetched().size();
+
+    query->columns.resize(query->query.columns.size());
+    query->chunks.resize(query->query.chunks.size());
+
+    for (std::size_t i = 0; i < query->columns.size(); ++i) {
+        query->columns[i] = FfiQueryColumn{ query->query.columns[i].data };
+    }
+
+    for (std::size_t i = 0; i < query->chunks.size(); ++i) {
+        const auto& chunk = query->query.chunks[i];
+        query->chunks[i] = FfiQueryChunk{ query->columns.data() + i * termCount, chunk.entities, chunk.entityCount };
+    }
+
+    *outChunks = query->chunks.data();
+    return static_cast<int>(query->chunks.size());
+}
+
 extern "C" {
-    Query* _QueryCreate() {
-        return std::make_unique<Query>().release();
+    FfiQuery* _QueryCreate() {
+        return std::make_unique<FfiQuery>().release();
     }
 
-    int _QueryIter(World* world, component_id fetchBitmask, Query* query, QueryChunk** outChunks) {
-        query->fetch(&world->archetypes, fetchBitmask);
-        *outChunks = query->chunks.data();
-        return static_cast<int>(query->chunks.size());
+    /// Fetches the components of the bitmask from every matching archetype. Tags are required but get no
+    /// column in the chunks. Chunks stay valid until the next fetch through the query. Sparse components
+    /// can't be fetched, read them per entity through _WorldGet. Fetching them returns a negative error and
+    /// leaves `outChunks` untouched.
+    int _QueryIter(World* world, const Signature* fetchBitmask, FfiQuery* query, FfiQueryChunk** outChunks) {
+        if (!canFetch(world, *fetchBitmask)) {
+            return SparseFetchError;
+        }
+
+        query->query.fetch(&world->archetypes, *fetchBitmask);
+        return mirrorChunks(query, outChunks);
+    }
+
+    /// Like _QueryIter, with archetype filters. Null masks are empty. Optional components are fetched next to
+    /// `fetchBitmask` in id order and their columns are null in chunks lacking them. Matching archetypes must
+    /// intersect every one of the `anyOfCount` masks at `anyOf`.
+    int _QueryIterFiltered(
+        World* world, const Signature* fetchBitmask, const Signature* with, const Signature* without,
+        const Signature* optional, const Signature* anyOf, std::size_t anyOfCount, FfiQuery* query, FfiQueryChunk** outChunks
+    ) {
+        // Reused between calls, so steady state iteration doesn't allocate.
+        thread_local QueryFilter filter;
+
+        filter.with = with ? *with : Signature{};
+        filter.without = without ? *without : Signature{};
+        filter.optional = optional ? *optional : Signature{};
+        filter.anyOf.assign(anyOf, anyOf + (anyOf ? anyOfCount : 0));
+
+        if (!canFetch(world, *fetchBitmask | filter.optional)) {
+            return SparseFetchError;
+        }
+
+        query->query.fetch(&world->archetypes, *fetchBitmask, filter);
+        return mirrorChunks(query, outChunks);
+    }
+
+    /// Marks every row of a column of the last fetch's chunk as changed at the world's tick. Writes through
+    /// chunk data are otherwise invisible to Changed filters, deltas and world views.
+    void _QueryMarkChanged(World* world, FfiQuery* query, std::size_t chunk, std::size_t column) {
+        assert(chunk < query->query.chunks.size() && column < query->query.fetched().size());
+
+        auto ticks = query->query.chunks[chunk].columns[column].chunkTicks;
+
+        if (ticks == nullptr) {
+            return;
+        }
+
+        auto tick = world->changeTick();
+        ticks->latest = tick;
+        ticks->bulk = tick;
+        ticks->hasBulk = true;
     }
 
-    void _QueryDestroy(Query* query) {
-        std::unique_ptr<Query> _(query);
+    void _QueryDestroy(FfiQuery* query) {
+        std::unique_ptr<FfiQuery> _(query);
     }
 }
@@ -1,5 +1,13 @@
+#include "../snapshot.hpp"
 #include "../world.hpp"
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// Entities cross the FFI by value as 8 bytes: the 32-bit id followed by the 32-bit generation.
+static_assert(offsetof(Entity, id) == 0 && offsetof(Entity, generation) == 4 && sizeof(EntityId) == 4);
+
 extern "C" {
     World* _WorldCreate () {
         return std::make_unique<World>().release();
@@ -9,10 +17,47 @@ extern "C" {
         std::unique_ptr<World> _(world);
     }
 
+    /// Registers a component. A size of zero registers a tag, which gets no column and carries no bytes.
     component_id _WorldRegisterComponent(World* worldPtr, TypeInfo typeInfo) {
         return worldPtr->registerComponent(typeInfo);
     }
 
+    component_id _WorldRegisterSparseComponent(World* worldPtr, TypeInfo typeInfo) {
+        return worldPtr->registerComponent(typeInfo, StorageType::Sparse);
+    }
+
+    /// Registers a relation from the type info of a tag, see World::registerRelation.
+    component_id _WorldRegisterRelation(World* world, TypeInfo typeInfo, bool cascade) {
+        assert(typeInfo.size == 0 && "Relations are tags, pairs carry no data");
+
+        auto id = world->registerComponent(typeInfo);
+        world->relations.addRelation(id, cascade ? RelationCleanup::Cascade : RelationCleanup::Remove);
+        return id;
+    }
+
+    component_id _WorldPair(World* world, component_id relation, Entity target) {
+        return world->pair(relation, target);
+    }
+
+    void _WorldAddPair(World* world, Entity entity, component_id relation, Entity target) {
+        world->addPair(entity, relation, target);
+    }
+
+    void _WorldRemovePair(World* world, Entity entity, component_id relation, Entity target) {
+        world->removePair(entity, relation, target);
+    }
+
+    /// Writes the target of the entity's `index`-th pair of the relation and returns whether it has one.
+    bool _WorldPairTarget(World* world, Entity entity, component_id relation, std::size_t index, Entity* outTarget) {
+        auto target = world->target(entity, relation, index);
+
+        if (target.has_value()) {
+            *outTarget = *target;
+        }
+
+        return target.has_value();
+    }
+
     Entity _WorldSpawnEmpty(World* world) {
         return world->spawnEmpty();
     }
@@ -22,6 +67,10 @@ extern "C" {
         return world->spawnBundle(std::move(bundle));
     }
 
+    void _WorldSpawnBatch(World* world, const Signature* bitmask, std::size_t count, std::byte** columns, Entity* outEntities) {
+        world->spawnBatch(*bitmask, count, columns, outEntities);
+    }
+
     void _WorldInsert(World* world, Entity entity, Bundle* bundlePtr) {
         std::unique_ptr<Bundle> bundle(bundlePtr);
         world->insertBundle(entity, std::move(bundle));
@@ -32,11 +81,55 @@ extern "C" {
         world->removeBundle(entity, std::move(bundle));
     }
 
+    /// Spawns an entity with every component of the bitmask, read from the caller's buffer in id order
+    /// without padding. Components are relocated out of the buffer and nothing is allocated for the call.
+    Entity _WorldSpawnBuffer(World* world, const Signature* bitmask, std::byte* buffer) {
+        return world->spawnBundle(Bundle(world->components.get(), *bitmask, buffer, bitmask->count()));
+    }
+
+    /// Like _WorldSpawnBuffer, for inserting into an existing entity.
+    void _WorldInsertBuffer(World* world, Entity entity, const Signature* bitmask, std::byte* buffer) {
+        world->insertBundle(entity, Bundle(world->components.get(), *bitmask, buffer, bitmask->count()));
+    }
+
+    void _WorldRemoveComponents(World* world, Entity entity, const Signature* bitmask) {
+        world->removeComponents(entity, *bitmask);
+    }
+
     void _WorldDespawn(World* world, Entity entity) {
         world->despawn(entity);
     }
 
-    std::byte* _WorldGet(World* world, Entity entity, component_id bit) {
-        return world->get(entity, bit);
+    std::byte* _WorldGet(World* world, Entity entity, component_id id) {
+        return world->get(entity, id);
+    }
+
+    /// Sets the hook of the component's event, 0 for add, 1 for replace and 2 for remove. The callback gets
+    /// the entities as an array and the caller's `user` pointer back. A null callback removes the hook.
+    void _WorldSetHook(
+        World* world,
+        component_id id,
+        std::uint8_t event,
+        void (*hook)(World* world, component_id id, const Entity* entities, std::size_t count, void* user),
+        void* user
+    ) {
+        if (hook == nullptr) {
+            world->setHook(id, ComponentEvent(event), nullptr);
+            return;
+        }
+
+        world->setHook(id, ComponentEvent(event), [hook, user](World& world, component_id id, std::span<const Entity> entities) {
+            hook(&world, id, entities.data(), entities.size(), user);
+        });
+    }
+
+    void _WorldSaveSnapshot(World* world, const char* path) {
+        saveSnapshot(*world, path);
+    }
+
+    /// Restores a snapshot into a world without entities, see loadSnapshot. With `adopt`, chunked archetypes
+    /// use the mapped file's blocks in place.
+    void _WorldLoadSnapshot(World* world, const char* path, bool adopt) {
+        loadSnapshot(*world, path, adopt ? SnapshotLoad::Adopt : SnapshotLoad::Copy);
     }
 }
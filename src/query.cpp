@@ -1,31 +1,257 @@
 #include "query.hpp"
 #include "archetype.hpp"
 
-#include <bit>
+#include <algorithm>
+#include <atomic>
+#include <tuple>
 
-void Query::fetch(Archetypes* archetypes, component_id fetchBitmask) {
-    this->chunks.clear();
-    this->columns.clear();
+Query::Query(std::vector<component_id> fetch, QueryFilter filter) {
+    this->reset(std::move(fetch), std::move(filter));
+}
+
+void Query::fetch(Archetypes* archetypes, const Signature& fetchBitmask, const QueryFilter& filter) {
+    // Tags have no column to fetch, so fetched ones are only required and optional ones match anything.
+    auto fetchAll = (fetchBitmask | filter.optional) & ~archetypes->tagMask();
+    auto required = (fetchBitmask & ~filter.optional) | filter.with;
+
+    if (required != this->_bitmask || filter != this->_filter || this->_fetch.size() != fetchAll.count()) {
+        std::vector<component_id> fetch;
+        fetch.reserve(fetchAll.count());
+
+        fetchAll.forEach([&](component_id id) {
+            fetch.push_back(id);
+        });
+
+        this->reset(std::move(fetch), filter);
+        this->_bitmask = required;
+    }
+
+    this->update(archetypes);
+}
+
+void Query::update(Archetypes* archetypes, const Entities* entities) {
+    const auto termCount = this->_fetch.size();
+    const auto archetypeCount = archetypes->length();
+
+    this->_sparse = archetypes->sparseMask() & (this->_bitmask | this->_filter.optional);
+
+    assert(!this->_filter.with.intersects(this->_sparse) && !this->_filter.without.intersects(archetypes->sparseMask())
+        && "Archetype filters can't test sparse components");
+
+    this->_cache.positions.resize(archetypeCount, QueryCache::absent);
+
+    for (auto index = this->_cache.highWatermark; index < archetypeCount; ++index) {
+        auto archetype = archetypes->at(index);
+
+        if (!this->matches(archetype->bitmask())) {
+            continue;
+        }
+
+        this->_cache.positions[index] = this->_cache.matching.size();
+        this->_cache.matching.push_back(index);
+
+        for (auto id : this->_fetch) {
+            this->_cache.columnIndices.push_back(archetype->bitmask().test(id) ? archetype->columnIndex(id) : QueryCache::absent);
+        }
+    }
+    this->_cache.highWatermark = archetypeCount;
+
+    if (entities != nullptr && !this->requiredSparse().empty()) {
+        this->updateJoined(archetypes, *entities);
+        return;
+    }
+
+    std::size_t chunkCount = 0;
+    for (auto index : this->_cache.matching) {
+        chunkCount += archetypes->at(index)->chunkCount();
+    }
+
+    // Only reallocates when the number of chunks grew, otherwise pointers are refreshed in place.
+    this->columns.resize(chunkCount * termCount);
+    this->chunks.resize(chunkCount);
+
+    std::size_t chunk = 0;
+
+    for (std::size_t position = 0; position < this->_cache.matching.size(); ++position) {
+        auto archetype = archetypes->at(this->_cache.matching[position]);
+        auto rows = archetype->chunkRows();
+
+        // Chunked archetypes hand out a chunk per block, contiguous ones a single chunk of every row.
+        for (std::size_t page = 0; page < archetype->chunkCount(); ++page, ++chunk) {
+            this->fillChunk(archetypes, position, page, chunk, std::min(rows, archetype->length() - page * rows), nullptr);
+        }
+    }
+}
+
+void Query::updateJoined(Archetypes* archetypes, const Entities& entities) {
+    const auto termCount = this->_fetch.size();
+
+    // Rows must be in every required set, so the smallest one bounds the work.
+    SparseSet* driver = nullptr;
+    this->requiredSparse().forEach([&](component_id id) {
+        auto set = archetypes->sparseSet(id);
+
+        if (driver == nullptr || set->length() < driver->length()) {
+            driver = set;
+        }
+    });
+
+    auto locations = entities.archetypeData();
+    auto rows = entities.rowData();
+
+    this->_joined.clear();
+
+    for (auto entity : driver->entities()) {
+        auto index = locations[entity.id];
+        auto position = index < this->_cache.positions.size() ? this->_cache.positions[index] : QueryCache::absent;
+
+        if (position == QueryCache::absent) {
+            continue;
+        }
+
+        auto chunkRows = archetypes->at(index)->chunkRows();
+        auto row = rows[entity.id];
+
+        this->_joined.push_back(JoinedRow{ std::uint32_t(position), std::uint32_t(row / chunkRows), std::uint32_t(row % chunkRows) });
+    }
 
-    for (auto& archetype : archetypes->archetypes()) {
-        if ((archetype.bitmask() & fetchBitmask) == fetchBitmask) {
-            size_t poolStartIndex = this->columns.size();
+    // Grouped by chunk, rows in storage order.
+    std::ranges::sort(this->_joined, [](const JoinedRow& lhs, const JoinedRow& rhs) {
+        return std::tie(lhs.position, lhs.page, lhs.row) < std::tie(rhs.position, rhs.page, rhs.row);
+    });
 
-            auto mask = fetchBitmask;
+    std::size_t chunkCount = 0;
+    this->_joinedRows.resize(this->_joined.size());
 
-            for (std::size_t i = 0; i < std::popcount(fetchBitmask); ++i) {
-                if (mask == 0) break;
-                auto index = std::countr_zero(mask);
-                auto bit = component_id(1) << index;
+    for (std::size_t i = 0; i < this->_joined.size(); ++i) {
+        this->_joinedRows[i] = this->_joined[i].row;
 
-                if (fetchBitmask & bit) {
-                    this->columns.push_back({ (std::byte*)archetype.getColumn(bit)->data() });
-                }
+        if (i == 0 || this->_joined[i].position != this->_joined[i - 1].position || this->_joined[i].page != this->_joined[i - 1].page) {
+            chunkCount++;
+        }
+    }
+
+    this->columns.resize(chunkCount * termCount);
+    this->chunks.resize(chunkCount);
+
+    std::size_t chunk = 0;
+
+    for (std::size_t begin = 0, end = 0; begin < this->_joined.size(); begin = end, ++chunk) {
+        const auto& first = this->_joined[begin];
+
+        while (end < this->_joined.size() && this->_joined[end].position == first.position && this->_joined[end].page == first.page) {
+            end++;
+        }
+
+        this->fillChunk(archetypes, first.position, first.page, chunk, end - begin, this->_joinedRows.data() + begin);
+    }
+}
+
+void Query::fillChunk(Archetypes* archetypes, std::size_t position, std::size_t page, std::size_t chunk, std::size_t length, const std::uint32_t* rows) {
+    const auto termCount = this->_fetch.size();
 
-                mask ^= bit;
-            }
+    auto archetype = archetypes->at(this->_cache.matching[position]);
+    auto indices = this->_cache.columnIndices.data() + position * termCount;
+    auto columns = this->columns.data() + chunk * termCount;
+    auto begin = page * archetype->chunkRows();
 
-            chunks.push_back({ &this->columns[poolStartIndex], archetype.entityData(), archetype.length() });
+    for (std::size_t term = 0; term < termCount; ++term) {
+        if (this->_sparse.test(this->_fetch[term])) {
+            auto set = archetypes->sparseSet(this->_fetch[term]);
+            auto& dense = set->dense();
+
+            columns[term] = QueryColumn{
+                dense.length() > 0 ? dense.get(0) : nullptr,
+                dense.addedTicks(),
+                dense.changedTicks(),
+                dense.pageTicks(0),
+                set
+            };
+            continue;
+        }
+
+        if (indices[term] == QueryCache::absent) {
+            columns[term] = QueryColumn{};
+            continue;
         }
+
+        auto column = archetype->columnAt(indices[term]);
+        columns[term] = QueryColumn{
+            column->page(page),
+            column->addedTicks() + begin,
+            column->changedTicks() + begin,
+            column->pageTicks(page),
+            nullptr
+        };
+    }
+
+    this->chunks[chunk] = QueryChunk{
+        columns,
+        archetype->entityData() + begin,
+        length,
+        !this->_sparse.empty(),
+        rows
+    };
+}
+
+void Query::reset(std::vector<component_id> fetch, QueryFilter filter) {
+    this->_bitmask = filter.with;
+    for (auto id : fetch) {
+        if (!filter.optional.test(id)) {
+            this->_bitmask.set(id);
+        }
+    }
+
+    this->_fetch = std::move(fetch);
+    this->_filter = std::move(filter);
+    this->_cache = QueryCache{};
+    this->_lastRun = 0;
+    this->_ran = false;
+    this->columns.clear();
+    this->chunks.clear();
+}
+
+bool Query::matches(const Signature& bitmask) const {
+    if (!bitmask.contains(this->_bitmask & ~this->_sparse) || bitmask.intersects(this->_filter.without)) {
+        return false;
     }
+
+    return std::ranges::all_of(this->_filter.anyOf, [&](const Signature& any) {
+        return bitmask.intersects(any);
+    });
+}
+
+Tick Query::lastRun() const {
+    return this->_lastRun;
+}
+
+void Query::clampTicks(Tick thisRun) {
+    if (this->_ran) {
+        this->_lastRun = clampTick(this->_lastRun, thisRun);
+    }
+}
+
+const Signature& Query::bitmask() const {
+    return this->_bitmask;
+}
+
+const QueryFilter& Query::filter() const {
+    return this->_filter;
+}
+
+const std::vector<component_id>& Query::fetched() const {
+    return this->_fetch;
+}
+
+const std::vector<std::size_t>& Query::matching() const {
+    return this->_cache.matching;
+}
+
+Signature Query::requiredSparse() const {
+    return this->_bitmask & this->_sparse;
+}
+
+std::size_t Query::nextSlot() {
+    static std::atomic<std::size_t> slot = 0;
+    return slot.fetch_add(1, std::memory_order_relaxed);
 }
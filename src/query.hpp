@@ -1,27 +1,324 @@
 #pragma once
 
 #include "archetype.hpp"
+#include "thread_pool.hpp"
+#include "tick.hpp"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <print>
+#include <span>
+#include <type_traits>
 #include <vector>
 
-// FUTURE
 struct QueryCache {
+    /// Indices of the matching archetypes, in creation order.
     std::vector<std::size_t> matching;
-    component_id highWatermark;
+    /// Column positions inside every matching archetype, one entry per fetched component. Optional components
+    /// the archetype lacks are `absent`.
+    std::vector<std::size_t> columnIndices;
+    /// Position in `matching` of every tested archetype, `absent` for those that don't match.
+    std::vector<std::size_t> positions;
+    /// Number of archetypes already tested against the query.
+    std::size_t highWatermark = 0;
+
+    static constexpr std::size_t absent = std::size_t(-1);
 };
 
+/// Column of a chunk. Every pointer is null when the chunk's archetype lacks an optional component. The
+/// layout is internal, the FFI mirrors only `data` into chunks of its own.
 struct QueryColumn {
     std::byte* data;
+    /// Ticks of the chunk's rows.
+    Tick* added;
+    Tick* changed;
+    PageTicks* chunkTicks;
+    /// Set of a sparse component. Its data and ticks cover the whole set and are indexed by the row
+    /// SparseSet::row returns for the entity, instead of the row in the chunk.
+    SparseSet* sparse;
 };
 
 struct QueryChunk {
     QueryColumn* columns;
     Entity* entities;
+    /// Number of rows to visit.
     std::size_t entityCount;
+    /// Whether some columns are sparse, so rows are joined through their entities.
+    bool sparse;
+    /// Rows of the chunk to visit when a required sparse set drives the iteration, null to visit rows 0 to
+    /// `entityCount`.
+    const std::uint32_t* rows;
+};
+
+/// Layout of a chunk handed over by chunk iteration, for kernels processing rows in blocks of SIMD lanes.
+struct QueryChunkInfo {
+    /// Number of rows in every span of the chunk.
+    std::size_t length;
+    /// Alignment in bytes shared by the first row of every component span. Storage aligns columns to
+    /// BlobVector::bufferAlign, so this is the full cache line unless a component's size breaks it.
+    std::size_t alignment;
+
+    /// Returns the rows left over after processing the chunk in blocks of `lanes` rows.
+    [[nodiscard]] constexpr std::size_t remainder(std::size_t lanes) const {
+        return this->length % lanes;
+    }
+
+    /// Returns the rows covered by whole blocks of `lanes` rows, starting at row 0.
+    [[nodiscard]] constexpr std::size_t body(std::size_t lanes) const {
+        return this->length - this->remainder(lanes);
+    }
+};
+
+/// Query filter matching entities whose component was added since the query last ran.
+template<typename T>
+struct Added {
+    using Component = T;
+};
+
+/// Query filter matching entities whose component was added or mutably accessed since the query last ran.
+template<typename T>
+struct Changed {
+    using Component = T;
+};
+
+/// Query filter matching entities that have the component, without fetching it.
+template<typename T>
+struct With {};
+
+/// Query filter matching entities that don't have the component.
+template<typename T>
+struct Without {};
+
+/// Query filter matching entities that have at least one of the components.
+template<typename... Ts>
+struct AnyOf {};
+
+/// Query term fetching the component when the entity has it. The iterator gets a pointer, null when absent.
+template<typename T>
+struct Option {
+    using Component = T;
+};
+
+template<typename T>
+struct IsChangeFilter : std::false_type {};
+
+template<typename T>
+struct IsChangeFilter<Added<T>> : std::true_type {};
+
+template<typename T>
+struct IsChangeFilter<Changed<T>> : std::true_type {};
+
+/// Filters deciding which archetypes match. They don't take a column.
+template<typename T>
+struct IsArchetypeFilter : std::false_type {};
+
+template<typename T>
+struct IsArchetypeFilter<With<T>> : std::true_type {};
+
+template<typename T>
+struct IsArchetypeFilter<Without<T>> : std::true_type {};
+
+template<typename... Ts>
+struct IsArchetypeFilter<AnyOf<Ts...>> : std::true_type {};
+
+template<typename T>
+struct IsOption : std::false_type {};
+
+template<typename T>
+struct IsOption<Option<T>> : std::true_type {};
+
+/// Filters aren't passed to the iterator.
+template<typename T>
+constexpr bool isQueryFilter = IsChangeFilter<std::remove_cv_t<T>>::value || IsArchetypeFilter<std::remove_cv_t<T>>::value;
+
+template<typename T>
+struct QueryTerm {
+    using Component = std::remove_cv_t<std::remove_reference_t<T>>;
+    static constexpr bool writes = !std::is_const_v<std::remove_reference_t<T>>;
+};
+
+template<typename T>
+struct QueryTerm<Added<T>> {
+    using Component = T;
+    static constexpr bool writes = false;
+};
+
+template<typename T>
+struct QueryTerm<Changed<T>> {
+    using Component = T;
+    static constexpr bool writes = false;
+};
+
+template<typename T>
+struct QueryTerm<Option<T>> {
+    using Component = std::remove_cv_t<T>;
+    static constexpr bool writes = !std::is_const_v<T>;
+};
+
+/// Component whose column a query term reads.
+template<typename T>
+using QueryTermComponent = typename QueryTerm<std::remove_cv_t<T>>::Component;
+
+/// Whether the term fetches a tag. Tags have no column, they match like `With<T>` and the iterator gets a
+/// reference to tagAddress().
+template<typename T>
+constexpr bool isQueryTag = !isQueryFilter<T> && !IsOption<std::remove_cv_t<T>>::value && std::is_empty_v<QueryTermComponent<T>>;
+
+/// Whether the term takes a column in every chunk.
+template<typename T>
+constexpr bool queryHasColumn = !std::is_same_v<std::decay_t<T>, Entity> && !IsArchetypeFilter<std::remove_cv_t<T>>::value && !isQueryTag<T>;
+
+/// Whether the term's rows are marked as changed when visited.
+template<typename T>
+constexpr bool queryWrites = queryHasColumn<T> && QueryTerm<std::remove_cv_t<T>>::writes && !std::is_const_v<T>;
+
+/// Whether change filters may reject single rows. Archetype filters only ever reject whole chunks.
+template<typename... Comps>
+constexpr bool queryFiltersRows = (IsChangeFilter<std::remove_cv_t<Comps>>::value || ...);
+
+/// Number of terms passed to the iterator.
+template<typename... Comps>
+constexpr std::size_t queryFetchCount = ((isQueryFilter<Comps> ? 0 : 1) + ... + 0);
+
+/// Returns the position in the type list of the index-th term passed to the iterator.
+template<typename... Comps>
+constexpr std::size_t queryFetchTerm(std::size_t index) {
+    constexpr bool isFilter[] = { isQueryFilter<Comps>..., false };
+
+    std::size_t term = 0;
+    for (;; ++term) {
+        if (!isFilter[term]) {
+            if (index == 0) {
+                break;
+            }
+            index--;
+        }
+    }
+    return term;
+}
+
+/// Returns the column position of the component at the given index of a query's type list.
+/// Entity, tags and archetype filters don't occupy a column, so they are skipped.
+template<typename... Comps>
+constexpr std::size_t queryColumnIndex(std::size_t index) {
+    constexpr bool hasColumn[] = { queryHasColumn<Comps>..., false };
+
+    std::size_t column = 0;
+    for (std::size_t i = 0; i < index; ++i) {
+        column += hasColumn[i] ? 1 : 0;
+    }
+    return column;
+}
+
+/// Returns what the iterator gets for a row of the term: a reference, or a pointer for optional terms.
+template<typename T, typename Data>
+decltype(auto) queryFetchRow(Data* data, std::size_t row) {
+    if constexpr (isQueryTag<T>) {
+        return (*data);
+    } else if constexpr (IsOption<std::remove_cv_t<T>>::value) {
+        return data == nullptr ? nullptr : data + row;
+    } else {
+        return (data[row]);
+    }
+}
+
+/// Returns the span chunk iteration hands over for the term: rows of its column, entities, or an empty span
+/// for optional components the chunk lacks.
+template<typename T>
+auto queryChunkSpan(const QueryChunk& chunk, const QueryColumn* column) {
+    using Term = std::remove_cv_t<T>;
+
+    if constexpr (std::is_same_v<Term, Entity>) {
+        return std::span<const Entity>(chunk.entities, chunk.entityCount);
+    } else if constexpr (IsOption<Term>::value) {
+        using Component = typename Term::Component;
+        auto data = reinterpret_cast<Component*>(column->data);
+        return data == nullptr ? std::span<Component>() : std::span<Component>(data, chunk.entityCount);
+    } else {
+        return std::span<T>(reinterpret_cast<T*>(column->data), chunk.entityCount);
+    }
+}
+
+/// Archetype-level conditions of a query next to its fetched components.
+struct QueryFilter {
+    /// Components matching archetypes must have without them being fetched.
+    Signature with;
+    /// Components matching archetypes must not have.
+    Signature without;
+    /// Fetched components matching archetypes may lack. Their columns are null in chunks of such archetypes.
+    Signature optional;
+    /// Groups of components of which matching archetypes must have at least one.
+    std::vector<Signature> anyOf;
+
+    bool operator==(const QueryFilter& other) const = default;
 };
 
+/// Returns the bitmask of the components named by a type list, leaving Entity out.
+template<typename... Comps>
+Signature componentBitmask(const Components& components) {
+    Signature bitmask;
+
+    (..., [&]() {
+        if constexpr (!std::is_same_v<std::decay_t<Comps>, Entity>) {
+            bitmask.set(components.getId<QueryTermComponent<Comps>>());
+        }
+    }());
+
+    return bitmask;
+}
+
+/// Returns the components whose columns a query's type list fetches, in the order of the list.
+template<typename... Comps>
+std::vector<component_id> queryFetch(const Components& components) {
+    std::vector<component_id> fetch;
+    fetch.reserve(sizeof...(Comps));
+
+    (..., [&]() {
+        if constexpr (queryHasColumn<Comps>) {
+            static_assert(!std::is_empty_v<QueryTermComponent<Comps>>, "Tags can't be optional and have no change ticks");
+            fetch.push_back(components.getId<QueryTermComponent<Comps>>());
+        }
+    }());
+
+    return fetch;
+}
+
+template<typename T>
+void addQueryFilter(QueryFilter& filter, const Components& components, With<T>) {
+    filter.with.set(components.getId<T>());
+}
+
+template<typename T>
+void addQueryFilter(QueryFilter& filter, const Components& components, Without<T>) {
+    filter.without.set(components.getId<T>());
+}
+
+template<typename... Ts>
+void addQueryFilter(QueryFilter& filter, const Components& components, AnyOf<Ts...>) {
+    filter.anyOf.push_back(componentBitmask<Ts...>(components));
+}
+
+/// Collects archetype filters and optional components of a query's type list.
+template<typename... Comps>
+QueryFilter queryFilter(const Components& components) {
+    QueryFilter filter;
+
+    (..., [&]() {
+        using T = std::remove_cv_t<Comps>;
+
+        if constexpr (IsOption<T>::value) {
+            filter.optional.set(components.getId<QueryTermComponent<T>>());
+        } else if constexpr (IsArchetypeFilter<T>::value) {
+            addQueryFilter(filter, components, T{});
+        } else if constexpr (isQueryTag<T>) {
+            filter.with.set(components.getId<QueryTermComponent<T>>());
+        }
+    }());
+
+    return filter;
+}
+
 class Query {
 public:
     std::vector<QueryColumn> columns;
@@ -30,27 +327,407 @@ public:
 public:
     Query() = default;
 
-    void fetch(Archetypes* archetypes, component_id fetchBitmask);
+    /// Creates a query that fetches the given components from archetypes passing the filter. Columns of every
+    /// chunk follow the order of `fetch`.
+    explicit Query(std::vector<component_id> fetch, QueryFilter filter = {});
+
+    /// Fetches components of the bitmask and optional components of the filter in id order. The cache is kept
+    /// as long as neither changes, so only archetypes created since the last fetch are tested.
+    void fetch(Archetypes* archetypes, const Signature& fetchBitmask, const QueryFilter& filter = {});
+
+    /// Matches archetypes created since the last update and refreshes column pointers of every chunk.
+    /// Doesn't allocate unless new archetypes matched. Given the entities, queries requiring sparse
+    /// components only get chunks for the entities of the smallest required set, found through their
+    /// locations, instead of every row of the matched archetypes.
+    void update(Archetypes* archetypes, const Entities* entities = nullptr);
+
+    /// Drops the cache and starts matching against the given components and filter.
+    void reset(std::vector<component_id> fetch, QueryFilter filter = {});
 
+    /// Returns whether archetypes of the bitmask match the query.
+    bool matches(const Signature& bitmask) const;
+
+    /// Returns the components matching archetypes must have: fetched ones that aren't optional, and `With` ones.
+    const Signature& bitmask() const;
+    const QueryFilter& filter() const;
+    const std::vector<component_id>& fetched() const;
+    /// Returns indices of the archetypes matched by the last update.
+    const std::vector<std::size_t>& matching() const;
+    /// Returns the sparse components matching rows must have, as of the last update. Archetype matching
+    /// can't test them, rows are joined through the sparse sets instead.
+    Signature requiredSparse() const;
+
+    /// Returns the tick of the last iteration, which change filters compare against.
+    Tick lastRun() const;
+
+    /// Pulls the last run up to the maximum age, see clampTick. Iterations clamp it themselves, the world's
+    /// passes clamp registered queries that didn't run for long.
+    void clampTicks(Tick thisRun);
+
+    /// Calls the iterator for every matching row. The iteration runs at `thisRun`: change filters match rows
+    /// changed after the previous iteration, and rows of non-const components are marked as changed.
     template<typename... Comps, typename Func, std::size_t... Is>
-    void iterate(Func&& iterator, std::index_sequence<Is...>) {
+    void iterate(Tick thisRun, Func&& iterator, std::index_sequence<Is...> sequence) {
+        this->_lastRun = this->_ran ? clampTick(this->_lastRun, thisRun) : firstRunTick(thisRun);
+
         for (auto& chunk : chunks) {
-            const auto batch_ptrs = std::make_tuple(
-                ([&]() {
-                    using T = std::tuple_element_t<Is, std::tuple<Comps...>>;
+            if (chunkMatches<Comps...>(chunk, this->_lastRun, thisRun)) {
+                markChunk<Comps...>(chunk, thisRun, sequence, !queryFiltersRows<Comps...> && !chunk.sparse);
+                iterateRows<Comps...>(chunk, 0, chunk.entityCount, this->_lastRun, thisRun, iterator, sequence);
+            }
+        }
+
+        this->_lastRun = thisRun;
+        this->_ran = true;
+    }
+
+    /// Splits matching rows into ranges of at least `minBatch` rows and calls the iterator on the pool's
+    /// threads. Returns once every row was visited, so the iterator must be safe to call concurrently.
+    template<typename... Comps, typename Func, std::size_t... Is>
+    void parallelIterate(ThreadPool& pool, Tick thisRun, std::size_t minBatch, Func&& iterator, std::index_sequence<Is...> sequence) {
+        this->_lastRun = this->_ran ? clampTick(this->_lastRun, thisRun) : firstRunTick(thisRun);
+
+        // Row offsets of every chunk are kept between calls, so steady state iteration doesn't allocate.
+        this->_offsets.resize(this->chunks.size() + 1);
+        this->_offsets[0] = 0;
+
+        // Chunks rejected by change filters are left empty. Chunk ticks are marked here, so workers sharing
+        // a chunk only ever write their own rows.
+        for (std::size_t i = 0; i < this->chunks.size(); ++i) {
+            auto matches = chunkMatches<Comps...>(this->chunks[i], this->_lastRun, thisRun);
+
+            if (matches) {
+                markChunk<Comps...>(this->chunks[i], thisRun, sequence, !queryFiltersRows<Comps...> && !this->chunks[i].sparse);
+            }
+
+            this->_offsets[i + 1] = this->_offsets[i] + (matches ? this->chunks[i].entityCount : 0);
+        }
 
-                    if constexpr (std::is_same_v<T, Entity>) {
-                        return chunk.entities;
+        auto lastRun = this->_lastRun;
+
+        pool.parallelFor(this->_offsets.back(), minBatch, [&](std::size_t begin, std::size_t end) {
+            auto chunk = std::size_t(std::upper_bound(this->_offsets.begin(), this->_offsets.end(), begin) - this->_offsets.begin()) - 1;
+
+            while (begin < end) {
+                auto chunkBegin = this->_offsets[chunk];
+                auto chunkEnd = std::min(end, this->_offsets[chunk + 1]);
+
+                iterateRows<Comps...>(this->chunks[chunk], begin - chunkBegin, chunkEnd - chunkBegin, lastRun, thisRun, iterator, sequence);
+
+                begin = chunkEnd;
+                chunk++;
+            }
+        });
+
+        this->_lastRun = thisRun;
+        this->_ran = true;
+    }
+
+    /// Calls the iterator once per non-empty chunk with its layout and a span per fetched term, in the order
+    /// of the type list. Change filters only skip whole chunks here, and mutable spans mark every row of
+    /// the chunk as changed.
+    template<typename... Comps, typename Func, std::size_t... Is>
+    void iterateChunks(Tick thisRun, Func&& iterator, std::index_sequence<Is...> sequence) {
+        this->_lastRun = this->_ran ? clampTick(this->_lastRun, thisRun) : firstRunTick(thisRun);
+
+        static_assert(!(isQueryTag<Comps> || ...), "Tags have no rows to span, filter them with With<T>");
+
+        for (auto& chunk : chunks) {
+            if (chunk.entityCount == 0 || !chunkMatches<Comps...>(chunk, this->_lastRun, thisRun)) {
+                continue;
+            }
+
+            assert(!chunk.sparse && "Sparse components can't be iterated as spans");
+
+            markChunk<Comps...>(chunk, thisRun, sequence, true);
+
+            auto info = QueryChunkInfo{ chunk.entityCount, BlobVector::bufferAlign };
+
+            (..., [&]() {
+                using T = std::remove_cv_t<std::tuple_element_t<Is, std::tuple<Comps...>>>;
+
+                if constexpr (queryHasColumn<T> && !IsChangeFilter<T>::value) {
+                    auto address = reinterpret_cast<std::uintptr_t>(chunk.columns[queryColumnIndex<Comps...>(Is)].data);
+
+                    if (address != 0) {
+                        info.alignment = std::min(info.alignment, std::size_t(address & (~address + 1)));
+                    }
+                }
+            }());
+
+            [&]<std::size_t... Js>(std::index_sequence<Js...>) {
+                iterator(info, queryChunkSpan<std::tuple_element_t<queryFetchTerm<Comps...>(Js), std::tuple<Comps...>>>(
+                    chunk, chunk.columns + queryColumnIndex<Comps...>(queryFetchTerm<Comps...>(Js))
+                )...);
+            }(std::make_index_sequence<queryFetchCount<Comps...>>{});
+        }
+
+        this->_lastRun = thisRun;
+        this->_ran = true;
+    }
+
+    /// Returns whether the chunk may hold rows passing the change filters, judging by its columns' change ticks.
+    template<typename... Comps>
+    static bool chunkMatches(const QueryChunk& chunk, Tick lastRun, Tick thisRun) {
+        std::size_t column = 0;
+        bool matches = true;
+
+        (..., [&]() {
+            using T = std::remove_cv_t<Comps>;
+
+            if constexpr (queryHasColumn<T>) {
+                if constexpr (IsChangeFilter<T>::value) {
+                    matches = matches && isNewerTick(chunk.columns[column].chunkTicks->latest, lastRun, thisRun);
+                }
+                column++;
+            }
+        }());
+
+        return matches;
+    }
+
+    /// Raises change ticks of the chunk's mutably fetched columns. When every row gets visited, `wholeChunk`
+    /// marks the whole chunk as changed at once instead of row by row.
+    template<typename... Comps, std::size_t... Is>
+    static void markChunk(const QueryChunk& chunk, Tick thisRun, std::index_sequence<Is...>, bool wholeChunk) {
+        if (chunk.entityCount == 0) {
+            return;
+        }
+
+        (..., [&]() {
+            using T = std::tuple_element_t<Is, std::tuple<Comps...>>;
+
+            if constexpr (queryWrites<T>) {
+                auto ticks = chunk.columns[queryColumnIndex<Comps...>(Is)].chunkTicks;
+
+                if (ticks == nullptr) {
+                    return;
+                }
+
+                ticks->latest = thisRun;
+
+                if (wholeChunk) {
+                    ticks->bulk = thisRun;
+                    ticks->hasBulk = true;
+                }
+            }
+        }());
+    }
+
+    /// Calls the iterator with every row of the chunk in [begin, end) that passes the change filters.
+    template<typename... Comps, typename Func, std::size_t... Is>
+    static void iterateRows(const QueryChunk& chunk, std::size_t begin, std::size_t end, Tick lastRun, Tick thisRun, Func& iterator, std::index_sequence<Is...> sequence) {
+        if (chunk.sparse) {
+            iterateSparseRows<Comps...>(chunk, begin, end, lastRun, thisRun, iterator, sequence);
+            return;
+        }
+
+        // Filters get the column's ticks instead of its data.
+        const auto batch_ptrs = std::make_tuple(
+            ([&]() {
+                using T = std::tuple_element_t<Is, std::tuple<Comps...>>;
+
+                if constexpr (std::is_same_v<T, Entity>) {
+                    return chunk.entities;
+                } else if constexpr (isQueryTag<T>) {
+                    return reinterpret_cast<T*>(tagAddress());
+                } else if constexpr (IsArchetypeFilter<std::remove_cv_t<T>>::value) {
+                    return nullptr;
+                } else if constexpr (IsChangeFilter<std::remove_cv_t<T>>::value) {
+                    return &chunk.columns[queryColumnIndex<Comps...>(Is)];
+                } else if constexpr (IsOption<std::remove_cv_t<T>>::value) {
+                    constexpr auto column = queryColumnIndex<Comps...>(Is);
+                    return reinterpret_cast<typename std::remove_cv_t<T>::Component*>(chunk.columns[column].data);
+                } else {
+                    constexpr auto column = queryColumnIndex<Comps...>(Is);
+                    return reinterpret_cast<T*>(chunk.columns[column].data);
+                }
+            }())...
+        );
+
+        constexpr bool filtered = queryFiltersRows<Comps...>;
+
+        auto matches = [&](std::size_t row) {
+            bool matches = true;
+
+            (..., [&]() {
+                using T = std::remove_cv_t<std::tuple_element_t<Is, std::tuple<Comps...>>>;
+
+                if constexpr (IsChangeFilter<T>::value) {
+                    const QueryColumn* column = std::get<Is>(batch_ptrs);
+
+                    if constexpr (std::is_same_v<T, Added<typename T::Component>>) {
+                        matches = matches && isNewerTick(column->added[row], lastRun, thisRun);
                     } else {
-                        return reinterpret_cast<T*>(chunk.columns[Is].data);
+                        auto bulk = column->chunkTicks->hasBulk && isNewerTick(column->chunkTicks->bulk, lastRun, thisRun);
+                        matches = matches && (bulk || isNewerTick(column->changed[row], lastRun, thisRun));
+                    }
+                }
+            }());
+
+            return matches;
+        };
+
+        // Change filters skip rows, so visited rows of mutably fetched columns are marked one by one.
+        auto markRow = [&](std::size_t row) {
+            (..., [&]() {
+                using T = std::tuple_element_t<Is, std::tuple<Comps...>>;
+
+                if constexpr (queryWrites<T>) {
+                    auto changed = chunk.columns[queryColumnIndex<Comps...>(Is)].changed;
+
+                    if (changed != nullptr) {
+                        changed[row] = thisRun;
+                    }
+                }
+            }());
+        };
+
+        [&]<std::size_t... Js>(std::index_sequence<Js...>) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if constexpr (filtered) {
+                    if (!matches(i)) {
+                        continue;
                     }
-                }())...
-            );
 
-            const std::size_t count = chunk.entityCount;
-            for (std::size_t i = 0; i < count; ++i) {
-                iterator((std::get<Is>(batch_ptrs)[i])...);
+                    markRow(i);
+                }
+
+                iterator(queryFetchRow<std::tuple_element_t<queryFetchTerm<Comps...>(Js), std::tuple<Comps...>>>(
+                    std::get<queryFetchTerm<Comps...>(Js)>(batch_ptrs), i
+                )...);
             }
+        }(std::make_index_sequence<queryFetchCount<Comps...>>{});
+    }
+
+    /// Like iterateRows, for chunks joining sparse components. Every row looks up the entity in the sparse
+    /// sets, and entities lacking a required sparse component are skipped. Rows of the chunk are picked
+    /// through `rows` when it has them.
+    template<typename... Comps, typename Func, std::size_t... Is>
+    static void iterateSparseRows(const QueryChunk& chunk, std::size_t begin, std::size_t end, Tick lastRun, Tick thisRun, Func& iterator, std::index_sequence<Is...>) {
+        constexpr std::size_t columnCount = (std::size_t(queryHasColumn<Comps>) + ... + 0);
+
+        // Row of every column: the chunk's row, or the entity's row in a sparse set.
+        std::size_t rows[columnCount > 0 ? columnCount : 1];
+
+        auto matches = [&](std::size_t index) {
+            bool matches = true;
+
+            (..., [&]() {
+                using T = std::remove_cv_t<std::tuple_element_t<Is, std::tuple<Comps...>>>;
+
+                if constexpr (queryHasColumn<T>) {
+                    constexpr auto column = queryColumnIndex<Comps...>(Is);
+                    const auto& data = chunk.columns[column];
+
+                    rows[column] = data.sparse != nullptr ? data.sparse->row(chunk.entities[index].id) : index;
+
+                    if constexpr (!IsOption<T>::value) {
+                        matches = matches && rows[column] != SparseSet::npos;
+                    }
+                }
+            }());
+
+            (..., [&]() {
+                using T = std::remove_cv_t<std::tuple_element_t<Is, std::tuple<Comps...>>>;
+
+                if constexpr (IsChangeFilter<T>::value) {
+                    constexpr auto column = queryColumnIndex<Comps...>(Is);
+                    const auto& data = chunk.columns[column];
+
+                    if (!matches) {
+                        return;
+                    }
+
+                    if constexpr (std::is_same_v<T, Added<typename T::Component>>) {
+                        matches = isNewerTick(data.added[rows[column]], lastRun, thisRun);
+                    } else {
+                        auto bulk = data.chunkTicks->hasBulk && isNewerTick(data.chunkTicks->bulk, lastRun, thisRun);
+                        matches = bulk || isNewerTick(data.changed[rows[column]], lastRun, thisRun);
+                    }
+                }
+            }());
+
+            return matches;
+        };
+
+        auto markRow = [&]() {
+            (..., [&]() {
+                using T = std::tuple_element_t<Is, std::tuple<Comps...>>;
+
+                if constexpr (queryWrites<T>) {
+                    constexpr auto column = queryColumnIndex<Comps...>(Is);
+                    auto changed = chunk.columns[column].changed;
+
+                    if (changed != nullptr && rows[column] != SparseSet::npos) {
+                        changed[rows[column]] = thisRun;
+                    }
+                }
+            }());
+        };
+
+        [&]<std::size_t... Js>(std::index_sequence<Js...>) {
+            for (std::size_t i = begin; i < end; ++i) {
+                auto index = chunk.rows != nullptr ? std::size_t(chunk.rows[i]) : i;
+
+                if (!matches(index)) {
+                    continue;
+                }
+
+                markRow();
+
+                iterator(sparseFetchRow<std::tuple_element_t<queryFetchTerm<Comps...>(Js), std::tuple<Comps...>>>(
+                    chunk, index, queryColumnIndex<Comps...>(queryFetchTerm<Comps...>(Js)), rows
+                )...);
+            }
+        }(std::make_index_sequence<queryFetchCount<Comps...>>{});
+    }
+
+    /// Returns what the iterator gets for a term of a row joined with sparse components.
+    template<typename T>
+    static decltype(auto) sparseFetchRow(const QueryChunk& chunk, std::size_t index, std::size_t column, const std::size_t* rows) {
+        using Term = std::remove_cv_t<T>;
+
+        if constexpr (std::is_same_v<Term, Entity>) {
+            return (chunk.entities[index]);
+        } else if constexpr (isQueryTag<T>) {
+            return (*reinterpret_cast<T*>(tagAddress()));
+        } else if constexpr (IsOption<Term>::value) {
+            auto data = reinterpret_cast<typename Term::Component*>(chunk.columns[column].data);
+            return data == nullptr || rows[column] == SparseSet::npos ? nullptr : data + rows[column];
+        } else {
+            return (reinterpret_cast<T*>(chunk.columns[column].data)[rows[column]]);
         }
     }
+
+    /// Returns a process-wide unique slot used by World to keep one registered query per type list.
+    static std::size_t nextSlot();
+
+private:
+    /// Row of the driving sparse set's entity: the position of its archetype in the cache, its page there
+    /// and its row in the page.
+    struct JoinedRow {
+        std::uint32_t position;
+        std::uint32_t page;
+        std::uint32_t row;
+    };
+
+    /// Builds chunks of the rows whose entities are in the smallest required sparse set.
+    void updateJoined(Archetypes* archetypes, const Entities& entities);
+    /// Points the chunk at the page of the matched archetype at `position`, visiting `rows` when not null.
+    void fillChunk(Archetypes* archetypes, std::size_t position, std::size_t page, std::size_t chunk, std::size_t length, const std::uint32_t* rows);
+
+    std::vector<component_id> _fetch;
+    Signature _bitmask;
+    QueryFilter _filter;
+    /// Fetched components kept in sparse sets, which archetypes never contain.
+    Signature _sparse;
+    QueryCache _cache;
+    std::vector<std::size_t> _offsets;
+    /// Kept between updates, so steady state joins don't allocate.
+    std::vector<JoinedRow> _joined;
+    std::vector<std::uint32_t> _joinedRows;
+    Tick _lastRun = 0;
+    /// Whether the query iterated since it was reset. Change filters match every row on the first run.
+    bool _ran = false;
 };
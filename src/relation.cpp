@@ -0,0 +1,171 @@
+#include "relation.hpp"
+#include "archetype.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+void Relations::addRelation(component_id relation, RelationCleanup cleanup) {
+    assert(!this->_allPairs.test(relation) && "Pairs can't be relations");
+
+    this->_relations.set(relation);
+
+    if (cleanup == RelationCleanup::Cascade) {
+        this->_cascade.set(relation);
+    }
+
+    if (relation >= this->_pairs.size()) {
+        this->_pairs.resize(relation + 1);
+    }
+}
+
+bool Relations::isRelation(component_id id) const {
+    return this->_relations.test(id);
+}
+
+RelationCleanup Relations::cleanup(component_id relation) const {
+    return this->_cascade.test(relation) ? RelationCleanup::Cascade : RelationCleanup::Remove;
+}
+
+component_id Relations::find(component_id relation, Entity target) const {
+    auto id = this->_ids.find(key(relation, target));
+
+    if (id == this->_ids.end() || !(this->_info[id->second].target == target)) {
+        return none;
+    }
+
+    return id->second;
+}
+
+void Relations::add(component_id id, component_id relation, Entity target) {
+    assert(this->isRelation(relation));
+
+    if (id >= this->_info.size()) {
+        this->_info.resize(id + 1, RelationPair{ none, Entity{} });
+        this->_archetypes.resize(id + 1);
+    }
+
+    this->_info[id] = RelationPair{ relation, target };
+    this->_ids[key(relation, target)] = id;
+    this->_targets[target.id].push_back(id);
+    this->_pairs[relation].set(id);
+    this->_allPairs.set(id);
+    this->_version++;
+}
+
+void Relations::release(component_id id) {
+    auto [relation, target] = this->_info[id];
+    assert(relation != none && this->_pairs[relation].test(id) && "Pair was released already");
+
+    this->_ids.erase(key(relation, target));
+    this->_pairs[relation].reset(id);
+
+    auto targets = this->_targets.find(target.id);
+    std::erase(targets->second, id);
+
+    if (targets->second.empty()) {
+        this->_targets.erase(targets);
+    }
+
+    // The id stays in the archetype index, its archetypes are empty and hold the next pair using it.
+    this->_free.push_back(id);
+    this->_version++;
+}
+
+component_id Relations::reuse() {
+    if (this->_free.empty()) {
+        return none;
+    }
+
+    auto id = this->_free.back();
+    this->_free.pop_back();
+    return id;
+}
+
+const RelationPair& Relations::pair(component_id id) const {
+    assert(id < this->_info.size() && this->_info[id].relation != none && this->_pairs[this->_info[id].relation].test(id));
+
+    return this->_info[id];
+}
+
+const Signature& Relations::pairs(component_id relation) const {
+    assert(this->isRelation(relation));
+
+    return this->_pairs[relation];
+}
+
+std::span<const component_id> Relations::targeting(Entity entity) const {
+    auto targets = this->_targets.find(entity.id);
+
+    if (targets == this->_targets.end()) {
+        return {};
+    }
+
+    return targets->second;
+}
+
+bool Relations::empty() const {
+    return this->_targets.empty();
+}
+
+std::span<const RelationPair> Relations::pairData() const {
+    return this->_info;
+}
+
+std::span<const component_id> Relations::freeData() const {
+    return this->_free;
+}
+
+void Relations::restore(std::span<const RelationPair> pairs, std::span<const component_id> free) {
+    this->_info.assign(pairs.begin(), pairs.end());
+    this->_free.assign(free.begin(), free.end());
+    this->_ids.clear();
+    this->_targets.clear();
+    this->_allPairs = Signature{};
+
+    for (auto& relationPairs : this->_pairs) {
+        relationPairs = Signature{};
+    }
+
+    for (component_id id = 0; id < this->_info.size(); ++id) {
+        auto [relation, target] = this->_info[id];
+
+        if (relation == none) {
+            continue;
+        }
+
+        assert(this->isRelation(relation));
+        this->_allPairs.set(id);
+
+        if (std::ranges::find(this->_free, id) == this->_free.end()) {
+            this->_ids[key(relation, target)] = id;
+            this->_targets[target.id].push_back(id);
+            this->_pairs[relation].set(id);
+        }
+    }
+
+    this->_archetypes.assign(this->_info.size(), {});
+    this->_archetypeWatermark = 0;
+    this->_version++;
+}
+
+std::uint64_t Relations::version() const {
+    return this->_version;
+}
+
+void Relations::update(Archetypes& archetypes) {
+    for (auto index = this->_archetypeWatermark; index < archetypes.length(); ++index) {
+        (archetypes.at(index)->bitmask() & this->_allPairs).forEach([&](component_id id) {
+            this->_archetypes[id].push_back(index);
+        });
+    }
+
+    this->_archetypeWatermark = archetypes.length();
+}
+
+std::span<const std::size_t> Relations::archetypes(component_id id) const {
+    if (id >= this->_archetypes.size()) {
+        return {};
+    }
+
+    return this->_archetypes[id];
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "entity.hpp"
+#include "signature.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+class Archetypes;
+
+/// What happens to entities holding a pair when the pair's target is despawned.
+enum class RelationCleanup : std::uint8_t {
+    /// The pair is removed from them, so no handle of the despawned target is left behind.
+    Remove,
+    /// They are despawned along with the target, and so on down the hierarchy.
+    Cascade,
+};
+
+/// Relation and target a pair's component id stands for.
+struct RelationPair {
+    component_id relation;
+    Entity target;
+};
+
+/// Registry of relationship pairs. A pair `(R, target)` is a tag with a component id of its own, so entities
+/// holding the same pair share an archetype. Entities holding any pair of R also have R itself in their
+/// signature, which makes R the `(R, *)` wildcard of queries. Ids of pairs whose target was despawned are
+/// reused for new pairs. Snapshots and deltas carry the registry along, see pairData.
+class Relations {
+public:
+    static constexpr component_id none = std::numeric_limits<component_id>::max();
+
+    void addRelation(component_id relation, RelationCleanup cleanup);
+    bool isRelation(component_id id) const;
+    RelationCleanup cleanup(component_id relation) const;
+
+    /// Returns the component id of the pair, or `none` when it was never created.
+    component_id find(component_id relation, Entity target) const;
+
+    /// Records `id` as the pair of the relation and target.
+    void add(component_id id, component_id relation, Entity target);
+
+    /// Forgets the pair, whose id no entity holds anymore, and keeps the id for reuse.
+    void release(component_id id);
+
+    /// Returns a released id to record a new pair under, or `none`.
+    component_id reuse();
+
+    const RelationPair& pair(component_id id) const;
+
+    /// Returns every pair of the relation.
+    const Signature& pairs(component_id relation) const;
+
+    /// Returns the pairs targeting the entity.
+    std::span<const component_id> targeting(Entity entity) const;
+
+    /// Returns whether some pair exists, so despawns have targets to clean up.
+    bool empty() const;
+
+    /// Relation and target of every pair id, indexed by component id, with `none` as the relation of other
+    /// ids. Released ids keep their last relation. Snapshots and deltas store this and the free ids.
+    std::span<const RelationPair> pairData() const;
+    std::span<const component_id> freeData() const;
+
+    /// Replaces every pair with the ones of another world's registry, whose relations are registered here
+    /// under the same ids. Archetypes are indexed again on the next update.
+    void restore(std::span<const RelationPair> pairs, std::span<const component_id> free);
+
+    /// Returns a counter raised by every change to the pairs, so deltas only send the registry when needed.
+    std::uint64_t version() const;
+
+    /// Indexes archetypes created since the last update by the pairs they hold.
+    void update(Archetypes& archetypes);
+
+    /// Returns indices of the archetypes holding the pair, as of the last update.
+    std::span<const std::size_t> archetypes(component_id id) const;
+
+private:
+    static std::uint64_t key(component_id relation, Entity target) {
+        return (std::uint64_t(relation) << 32) | target.id;
+    }
+
+    Signature _relations;
+    Signature _cascade;
+    Signature _allPairs;
+    /// Pair ids of every relation, indexed by the relation's id.
+    std::vector<Signature> _pairs;
+    /// Relation and target of every pair, indexed by component id.
+    std::vector<RelationPair> _info;
+    /// Pair id of every relation and target id.
+    std::unordered_map<std::uint64_t, component_id> _ids;
+    /// Pair ids targeting every entity id.
+    std::unordered_map<EntityId, std::vector<component_id>> _targets;
+    std::vector<component_id> _free;
+    std::uint64_t _version = 0;
+
+    /// Archetypes holding every pair id, and the number of archetypes already indexed.
+    std::vector<std::vector<std::size_t>> _archetypes;
+    std::size_t _archetypeWatermark = 0;
+};
@@ -0,0 +1,158 @@
+#include "scheduler.hpp"
+
+#include <cassert>
+
+SystemAccess& SystemAccess::read(component_id id) {
+    this->reads.set(id);
+    return *this;
+}
+
+SystemAccess& SystemAccess::write(component_id id) {
+    this->writes.set(id);
+    return *this;
+}
+
+bool SystemAccess::conflicts(const SystemAccess& other) const {
+    if (this->exclusive || other.exclusive) {
+        return true;
+    }
+
+    return this->writes.intersects(other.reads | other.writes) || other.writes.intersects(this->reads);
+}
+
+Scheduler::Scheduler(World& world) : _world(world) {}
+
+SystemId Scheduler::addSystem(std::string name, SystemAccess access, std::function<void(World&)> func) {
+    SystemId id = this->_systems.size();
+
+    auto system = std::make_unique<System>();
+    system->name = std::move(name);
+    system->access = access;
+    system->func = std::move(func);
+    system->task = [this, id](std::size_t, std::size_t) {
+        this->runSystem(id);
+    };
+
+    // Systems are added in execution order, so every edge of the graph points to a later system.
+    for (SystemId other = 0; other < id; ++other) {
+        if (this->_systems[other]->access.conflicts(access)) {
+            this->_systems[other]->dependents.push_back(id);
+            system->dependencies.push_back(other);
+        }
+    }
+
+    this->_systems.push_back(std::move(system));
+    return id;
+}
+
+void Scheduler::run() {
+    if (this->_systems.empty()) {
+        return;
+    }
+
+    auto& pool = this->_world.threadPool();
+
+    for (auto& system : this->_systems) {
+        system->pending.store(system->dependencies.size(), std::memory_order_relaxed);
+    }
+
+    this->_remaining.store(this->_systems.size());
+    this->_frameStart = Clock::now();
+
+    for (auto& system : this->_systems) {
+        if (system->dependencies.empty()) {
+            pool.submit(1, 1, system->task, this->_remaining);
+        }
+    }
+
+    pool.wait(this->_remaining);
+
+    // End of the frame is the sync point where commands recorded by systems are applied.
+    this->_world.flush();
+    this->_frameTime = Clock::now() - this->_frameStart;
+}
+
+void Scheduler::runSystem(SystemId id) {
+    auto& system = *this->_systems[id];
+    auto start = Clock::now();
+
+    system.func(this->_world);
+
+    auto end = Clock::now();
+    system.timing = SystemTiming{ start - this->_frameStart, end - start };
+
+    auto& pool = this->_world.threadPool();
+
+    for (auto dependent : system.dependents) {
+        auto& next = *this->_systems[dependent];
+
+        if (next.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pool.submit(1, 1, next.task, this->_remaining);
+        }
+    }
+}
+
+const std::string& Scheduler::name(SystemId system) const {
+    assert(system < this->_systems.size());
+
+    return this->_systems[system]->name;
+}
+
+const SystemTiming& Scheduler::timing(SystemId system) const {
+    assert(system < this->_systems.size());
+
+    return this->_systems[system]->timing;
+}
+
+const std::vector<SystemId>& Scheduler::dependencies(SystemId system) const {
+    assert(system < this->_systems.size());
+
+    return this->_systems[system]->dependencies;
+}
+
+std::vector<SystemId> Scheduler::criticalPath() const {
+    const auto count = this->_systems.size();
+
+    std::vector<std::chrono::nanoseconds> finish(count);
+    std::vector<SystemId> previous(count, count);
+
+    // Registration order is a topological order of the graph.
+    for (SystemId id = 0; id < count; ++id) {
+        std::chrono::nanoseconds longest{0};
+
+        for (auto dependency : this->_systems[id]->dependencies) {
+            if (finish[dependency] > longest) {
+                longest = finish[dependency];
+                previous[id] = dependency;
+            }
+        }
+
+        finish[id] = longest + this->_systems[id]->timing.duration;
+    }
+
+    std::vector<SystemId> path;
+    if (count == 0) {
+        return path;
+    }
+
+    SystemId last = 0;
+    for (SystemId id = 1; id < count; ++id) {
+        if (finish[id] > finish[last]) {
+            last = id;
+        }
+    }
+
+    for (auto id = last; id != count; id = previous[id]) {
+        path.insert(path.begin(), id);
+    }
+
+    return path;
+}
+
+std::chrono::nanoseconds Scheduler::frameTime() const {
+    return this->_frameTime;
+}
+
+std::size_t Scheduler::length() const {
+    return this->_systems.size();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "query.hpp"
+#include "signature.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using SystemId = std::size_t;
+
+/// Components a system reads and writes. Two systems conflict when one of them writes a component the
+/// other one touches, conflicting systems run in registration order.
+struct SystemAccess {
+    Signature reads;
+    Signature writes;
+    /// Exclusive systems may change the world's structure and never run alongside other systems.
+    bool exclusive = false;
+
+    SystemAccess& read(component_id id);
+    SystemAccess& write(component_id id);
+
+    bool conflicts(const SystemAccess& other) const;
+};
+
+struct SystemTiming {
+    /// Time from the start of the frame until the system started.
+    std::chrono::nanoseconds start{0};
+    std::chrono::nanoseconds duration{0};
+};
+
+class Scheduler {
+public:
+    explicit Scheduler(World& world);
+
+    /// Infers the access of a query's component list: const components and change filters are read, others are
+    /// written. Archetype filters like `Without<T>` don't touch component data.
+    template<typename... Comps>
+    SystemAccess accessOf() const {
+        SystemAccess access;
+
+        (..., [&]() {
+            using T = std::remove_reference_t<Comps>;
+
+            if constexpr (queryHasColumn<T>) {
+                auto id = this->_world.template getComponentId<QueryTermComponent<T>>();
+
+                if constexpr (queryWrites<T>) {
+                    access.write(id);
+                } else {
+                    access.read(id);
+                }
+            }
+        }());
+
+        return access;
+    }
+
+    /// Registers a system calling `func` for every entity matching `Comps`, like World::iter. Access is
+    /// inferred from the constness of the components. The system owns its query, so it can run next to
+    /// systems fetching the same components, and change filters compare against the system's last run.
+    template<typename... Comps, typename Func>
+    SystemId addSystem(std::string name, Func&& func) {
+        auto query = std::make_shared<Query>(queryFetch<Comps...>(*this->_world.components), queryFilter<Comps...>(*this->_world.components));
+
+        return this->addSystem(std::move(name), this->accessOf<Comps...>(),
+            [query, func = std::forward<Func>(func)](World& world) mutable {
+                query->update(&world.archetypes, &world.entities);
+                query->template iterate<Comps...>(world.incrementChangeTick(), func, std::make_index_sequence<sizeof...(Comps)>{});
+            }
+        );
+    }
+
+    /// Registers a system with explicitly declared access.
+    SystemId addSystem(std::string name, SystemAccess access, std::function<void(World&)> func);
+
+    /// Runs every system once on the world's thread pool and returns when all of them finished. A system
+    /// starts as soon as every earlier system it conflicts with is done. Commands recorded into
+    /// World::commands are applied once all systems are done.
+    void run();
+
+    const std::string& name(SystemId system) const;
+    const SystemTiming& timing(SystemId system) const;
+    const std::vector<SystemId>& dependencies(SystemId system) const;
+
+    /// Returns the chain of dependent systems with the longest total duration in the last run.
+    std::vector<SystemId> criticalPath() const;
+
+    /// Returns the wall time of the last run.
+    std::chrono::nanoseconds frameTime() const;
+
+    std::size_t length() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct System {
+        std::string name;
+        SystemAccess access;
+        std::function<void(World&)> func;
+
+        std::vector<SystemId> dependencies;
+        std::vector<SystemId> dependents;
+        std::atomic<std::size_t> pending = 0;
+
+        ThreadPool::RangeFunc task;
+        SystemTiming timing;
+    };
+
+    void runSystem(SystemId system);
+
+    World& _world;
+    std::vector<std::unique_ptr<System>> _systems;
+    std::atomic<std::size_t> _remaining = 0;
+
+    Clock::time_point _frameStart;
+    std::chrono::nanoseconds _frameTime{0};
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/// Maximum number of component types a world can register. Must be a multiple of 64.
+#ifndef WECS_MAX_COMPONENTS
+#define WECS_MAX_COMPONENTS 256
+#endif
+
+using component_id = std::uint32_t;
+
+/// Fixed-capacity bitset of component ids. Operations run over all words without early exits, so
+/// the fixed-size loops compile down to a handful of vector instructions.
+struct Signature {
+    static constexpr std::size_t capacity = WECS_MAX_COMPONENTS;
+    static constexpr std::size_t wordCount = capacity / 64;
+
+    static_assert(capacity % 64 == 0, "WECS_MAX_COMPONENTS must be a multiple of 64");
+
+    alignas(32) std::uint64_t words[wordCount] = {};
+
+    [[nodiscard]] static constexpr Signature of(component_id id) {
+        Signature signature;
+        signature.set(id);
+        return signature;
+    }
+
+    constexpr void set(component_id id) {
+        assert(id < capacity);
+        this->words[id / 64] |= std::uint64_t(1) << (id % 64);
+    }
+
+    constexpr void reset(component_id id) {
+        assert(id < capacity);
+        this->words[id / 64] &= ~(std::uint64_t(1) << (id % 64));
+    }
+
+    [[nodiscard]] constexpr bool test(component_id id) const {
+        assert(id < capacity);
+        return (this->words[id / 64] >> (id % 64)) & 1;
+    }
+
+    /// Returns true when every component of `other` is in this signature.
+    [[nodiscard]] constexpr bool contains(const Signature& other) const {
+        std::uint64_t missing = 0;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            missing |= other.words[i] & ~this->words[i];
+        }
+        return missing == 0;
+    }
+
+    /// Returns true when this signature shares at least one component with `other`.
+    [[nodiscard]] constexpr bool intersects(const Signature& other) const {
+        std::uint64_t common = 0;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            common |= other.words[i] & this->words[i];
+        }
+        return common != 0;
+    }
+
+    [[nodiscard]] constexpr bool empty() const {
+        std::uint64_t any = 0;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            any |= this->words[i];
+        }
+        return any == 0;
+    }
+
+    [[nodiscard]] constexpr std::size_t count() const {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            count += std::popcount(this->words[i]);
+        }
+        return count;
+    }
+
+    /// Returns the lowest component id in the signature. The signature must not be empty.
+    [[nodiscard]] constexpr component_id first() const {
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            if (this->words[i] != 0) {
+                return component_id(i * 64 + std::countr_zero(this->words[i]));
+            }
+        }
+
+        assert(false && "Signature is empty");
+        return component_id(capacity);
+    }
+
+    /// Calls the function with every component id of the signature in ascending order.
+    template<typename Func>
+    constexpr void forEach(Func&& func) const {
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            auto bits = this->words[i];
+
+            while (bits != 0) {
+                func(component_id(i * 64 + std::countr_zero(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    constexpr Signature operator|(const Signature& other) const {
+        Signature result;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            result.words[i] = this->words[i] | other.words[i];
+        }
+        return result;
+    }
+
+    constexpr Signature operator&(const Signature& other) const {
+        Signature result;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            result.words[i] = this->words[i] & other.words[i];
+        }
+        return result;
+    }
+
+    constexpr Signature operator~() const {
+        Signature result;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            result.words[i] = ~this->words[i];
+        }
+        return result;
+    }
+
+    constexpr Signature& operator|=(const Signature& other) {
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            this->words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    constexpr Signature& operator&=(const Signature& other) {
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            this->words[i] &= other.words[i];
+        }
+        return *this;
+    }
+
+    constexpr bool operator==(const Signature& other) const {
+        std::uint64_t diff = 0;
+        for (std::size_t i = 0; i < wordCount; ++i) {
+            diff |= this->words[i] ^ other.words[i];
+        }
+        return diff == 0;
+    }
+};
+
+template<>
+struct std::hash<Signature> {
+    std::size_t operator()(const Signature& signature) const noexcept {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (std::size_t i = 0; i < Signature::wordCount; ++i) {
+            hash = (hash ^ signature.words[i]) * 0x100000001b3;
+        }
+        return std::size_t(hash);
+    }
+};
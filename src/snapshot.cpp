@@ -0,0 +1,570 @@
+#include "snapshot.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr char snapshotMagic[8] = {'W', 'E', 'C', 'S', 'S', 'N', 'A', 'P'};
+    /// Alignment of every record and array in the file.
+    constexpr std::size_t sectionAlign = Archetype::chunkAlign;
+
+    struct SnapshotHeader {
+        char magic[8] = {};
+        std::uint32_t version;
+        std::uint32_t signatureWords;
+        std::uint64_t chunkSize;
+        std::uint32_t changeTick;
+        std::uint32_t componentCount;
+        std::uint64_t entityCount;
+        std::uint64_t freeCount;
+        std::uint64_t archetypeCount;
+        std::uint64_t sparseCount;
+        std::uint64_t pairCount;
+        std::uint64_t pairFreeCount;
+    };
+
+    struct ComponentRecord {
+        std::uint64_t size;
+        std::uint64_t align;
+        std::uint8_t storage;
+        std::uint8_t padding[7] = {};
+    };
+
+    /// Followed by the entities, then by `blockCount` blocks for chunked archetypes or one array per column
+    /// for contiguous ones, then by the added and changed ticks of every column.
+    struct ArchetypeRecord {
+        std::uint64_t bitmask[Signature::wordCount] = {};
+        std::uint64_t length;
+        std::uint64_t columnCount;
+        std::uint64_t chunkRows;
+        std::uint64_t blockCount;
+        std::uint64_t blockBytes;
+        std::uint8_t storage;
+        std::uint8_t padding[7] = {};
+    };
+
+    /// Followed by the entities, components, added and changed ticks of every row.
+    struct SparseRecord {
+        std::uint64_t component;
+        std::uint64_t length;
+    };
+
+    class SnapshotWriter {
+    public:
+        explicit SnapshotWriter(const std::filesystem::path& path) : _file(path, std::ios::binary | std::ios::trunc) {
+            if (!this->_file) {
+                throw std::runtime_error("Can't open snapshot file for writing: " + path.string());
+            }
+        }
+
+        /// Writes `count` elements, starting on the next section boundary.
+        template<typename T>
+        void write(const T* data, std::size_t count) {
+            static const std::byte zeros[sectionAlign] = {};
+            auto padding = (sectionAlign - this->_offset % sectionAlign) % sectionAlign;
+
+            this->_file.write(reinterpret_cast<const char*>(zeros), std::streamsize(padding));
+            this->_file.write(reinterpret_cast<const char*>(data), std::streamsize(count * sizeof(T)));
+            this->_offset += padding + count * sizeof(T);
+
+            if (!this->_file) {
+                throw std::runtime_error("Failed to write snapshot");
+            }
+        }
+
+        void close() {
+            this->_file.close();
+
+            if (!this->_file) {
+                throw std::runtime_error("Failed to write snapshot");
+            }
+        }
+
+    private:
+        std::ofstream _file;
+        std::size_t _offset = 0;
+    };
+
+    /// File mapped copy-on-write, so pages written through the mapping become private copies.
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+            auto file = CreateFileW(
+                path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+            );
+            LARGE_INTEGER size;
+
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+                if (file != INVALID_HANDLE_VALUE) {
+                    CloseHandle(file);
+                }
+                throw std::runtime_error("Can't open snapshot file: " + path.string());
+            }
+
+            this->_size = std::size_t(size.QuadPart);
+            auto mapping = this->_size > 0 ? CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+            CloseHandle(file);
+
+            if (mapping) {
+                this->_data = static_cast<std::byte*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+                // The view keeps the mapping alive.
+                CloseHandle(mapping);
+            }
+#else
+            auto fd = ::open(path.c_str(), O_RDONLY);
+            struct stat status;
+
+            if (fd < 0 || ::fstat(fd, &status) != 0) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                throw std::runtime_error("Can't open snapshot file: " + path.string());
+            }
+
+            this->_size = std::size_t(status.st_size);
+
+            if (this->_size > 0) {
+                auto data = ::mmap(nullptr, this->_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                this->_data = data == MAP_FAILED ? nullptr : static_cast<std::byte*>(data);
+            }
+
+            ::close(fd);
+#endif
+
+            if (!this->_data) {
+                throw std::runtime_error("Can't map snapshot file: " + path.string());
+            }
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+#ifdef _WIN32
+            UnmapViewOfFile(this->_data);
+#else
+            ::munmap(this->_data, this->_size);
+#endif
+        }
+
+        std::byte* data() const {
+            return this->_data;
+        }
+
+        std::size_t size() const {
+            return this->_size;
+        }
+
+    private:
+        std::byte* _data = nullptr;
+        std::size_t _size = 0;
+    };
+
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const MappedFile& file) : _data(file.data()), _size(file.size()) {}
+
+        /// Returns the next `count` elements, starting on the next section boundary.
+        template<typename T>
+        T* take(std::size_t count) {
+            auto offset = (this->_offset + sectionAlign - 1) / sectionAlign * sectionAlign;
+
+            if (offset > this->_size || count > (this->_size - offset) / sizeof(T)) {
+                throw std::runtime_error("Snapshot is truncated");
+            }
+
+            this->_offset = offset + count * sizeof(T);
+            return reinterpret_cast<T*>(this->_data + offset);
+        }
+
+    private:
+        std::byte* _data;
+        std::size_t _size;
+        std::size_t _offset = 0;
+    };
+
+    /// Bytes are copied as they are, so only trivially copyable components can be stored.
+    void checkStorable(TypeInfo typeInfo) {
+        if (!typeInfo.trivially_relocatable) {
+            throw std::runtime_error("Snapshots can only store trivially copyable components");
+        }
+    }
+
+    void writeTicks(SnapshotWriter& writer, BlobVector& column) {
+        column.flushPages();
+        writer.write(column.addedTicks(), column.length());
+        writer.write(column.changedTicks(), column.length());
+    }
+
+    void readTicks(SnapshotReader& reader, BlobVector& column, std::size_t length) {
+        auto added = reader.take<Tick>(length);
+        auto changed = reader.take<Tick>(length);
+
+        std::copy(added, added + length, column.addedTicks());
+        std::copy(changed, changed + length, column.changedTicks());
+    }
+    /// Walks every record of the file without touching the world, so a mismatched or truncated snapshot throws
+    /// before the load changes anything.
+    void validateSnapshot(World& world, SnapshotReader reader, const SnapshotHeader& header) {
+        auto& components = *world.components;
+        auto& archetypes = world.archetypes;
+        auto registered = components.count();
+
+        auto records = reader.take<ComponentRecord>(header.componentCount);
+        auto pairs = reader.take<RelationPair>(header.pairCount);
+        reader.take<component_id>(header.pairFreeCount);
+
+        // Ids past the registry are pairs the saved world created, registered on load as tags of their relation.
+        if (header.componentCount != std::max<std::size_t>(registered, header.pairCount)) {
+            throw std::runtime_error("Snapshot components don't match the world's");
+        }
+
+        Signature known;
+
+        for (std::size_t id = 0; id < header.componentCount; ++id) {
+            auto relation = id < registered ? component_id(id) : pairs[id].relation;
+
+            if (relation >= registered) {
+                throw std::runtime_error("Snapshot components don't match the world's");
+            }
+
+            auto typeInfo = components.getTypeInfo(relation);
+            auto storage = id < registered ? components.getStorageType(component_id(id)) : StorageType::Table;
+
+            if (records[id].size != typeInfo.size || records[id].align != typeInfo.align ||
+                records[id].storage != std::uint8_t(storage)) {
+                throw std::runtime_error("Snapshot components don't match the world's");
+            }
+
+            if (id < registered) {
+                known.set(component_id(id));
+            }
+        }
+
+        reader.take<EntityGeneration>(header.entityCount);
+        reader.take<std::uint32_t>(header.entityCount);
+        reader.take<std::uint32_t>(header.entityCount);
+        reader.take<EntityId>(header.freeCount);
+
+        std::unordered_set<Signature> seen;
+        std::size_t created = 0;
+
+        for (std::size_t index = 0; index < header.archetypeCount; ++index) {
+            auto& record = *reader.take<ArchetypeRecord>(1);
+
+            Signature bitmask;
+            std::copy(std::begin(record.bitmask), std::end(record.bitmask), bitmask.words);
+
+            // The world only has the root, every other archetype is appended in file order.
+            auto position = archetypes.exists(bitmask) ? archetypes.position(bitmask) : archetypes.length() + created++;
+            if (position != index || !seen.insert(bitmask).second) {
+                throw std::runtime_error("Snapshot archetypes are out of order");
+            }
+
+            bitmask.forEach([&](component_id id) {
+                if (id >= header.componentCount || components.sparse().test(id)) {
+                    throw std::runtime_error("Snapshot archetype layout doesn't match the world's");
+                }
+            });
+
+            // Unregistered pairs are tags without columns, so the layout is the same without them.
+            auto storage = ArchetypeStorage(record.storage);
+            auto layout = Archetype(bitmask & known, world.components, storage);
+
+            if (record.columnCount != layout.columnCount() ||
+                (storage == ArchetypeStorage::Chunked &&
+                 (record.chunkRows != layout.chunkRows() || record.blockBytes != layout.blockBytes()))) {
+                throw std::runtime_error("Snapshot archetype layout doesn't match the world's");
+            }
+
+            auto length = std::size_t(record.length);
+            reader.take<Entity>(length);
+
+            if (storage == ArchetypeStorage::Chunked) {
+                if (length > record.blockCount * record.chunkRows) {
+                    throw std::runtime_error("Snapshot archetype layout doesn't match the world's");
+                }
+
+                reader.take<std::byte>(record.blockCount * record.blockBytes);
+            } else {
+                for (std::size_t i = 0; i < layout.columnCount(); ++i) {
+                    reader.take<std::byte>(length * layout.columnAt(i)->typeInfo().size);
+                }
+            }
+
+            for (std::size_t i = 0; i < layout.columnCount(); ++i) {
+                reader.take<Tick>(length);
+                reader.take<Tick>(length);
+            }
+        }
+
+        for (std::size_t index = 0; index < header.sparseCount; ++index) {
+            auto& record = *reader.take<SparseRecord>(1);
+            auto set = record.component < registered ? archetypes.sparseSet(component_id(record.component)) : nullptr;
+
+            if (!set) {
+                throw std::runtime_error("Snapshot components don't match the world's");
+            }
+
+            auto length = std::size_t(record.length);
+            reader.take<Entity>(length);
+            reader.take<std::byte>(length * set->dense().typeInfo().size);
+            reader.take<Tick>(length);
+            reader.take<Tick>(length);
+        }
+    }
+}
+
+void saveSnapshot(World& world, const std::filesystem::path& path) {
+    world.entities.flush();
+
+    auto& components = *world.components;
+    auto& archetypes = world.archetypes;
+
+    for (auto& archetype : archetypes.archetypes()) {
+        for (std::size_t i = 0; i < archetype.columnCount() && archetype.length() > 0; ++i) {
+            checkStorable(archetype.columnAt(i)->typeInfo());
+        }
+    }
+
+    std::size_t sparseCount = 0;
+    components.sparse().forEach([&](component_id id) {
+        if (archetypes.sparseSet(id)->length() > 0) {
+            checkStorable(components.getTypeInfo(id));
+        }
+        sparseCount++;
+    });
+
+    SnapshotWriter writer(path);
+
+    SnapshotHeader header = {
+        .version = snapshotVersion,
+        .signatureWords = std::uint32_t(Signature::wordCount),
+        .chunkSize = Archetype::chunkSize,
+        .changeTick = world.changeTick(),
+        .componentCount = std::uint32_t(components.count()),
+        .entityCount = world.entities.generationData().size(),
+        .freeCount = world.entities.freeData().size(),
+        .archetypeCount = archetypes.length(),
+        .sparseCount = sparseCount,
+        .pairCount = world.relations.pairData().size(),
+        .pairFreeCount = world.relations.freeData().size(),
+    };
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    writer.write(&header, 1);
+
+    std::vector<ComponentRecord> records(components.count());
+    for (std::size_t id = 0; id < records.size(); ++id) {
+        auto typeInfo = components.getTypeInfo(component_id(id));
+        records[id] = ComponentRecord{
+            .size = typeInfo.size,
+            .align = typeInfo.align,
+            .storage = std::uint8_t(components.getStorageType(component_id(id))),
+        };
+    }
+    writer.write(records.data(), records.size());
+    writer.write(world.relations.pairData().data(), header.pairCount);
+    writer.write(world.relations.freeData().data(), header.pairFreeCount);
+
+    writer.write(world.entities.generationData().data(), header.entityCount);
+    writer.write(world.entities.archetypeData().data(), header.entityCount);
+    writer.write(world.entities.rowData().data(), header.entityCount);
+    writer.write(world.entities.freeData().data(), header.freeCount);
+
+    std::vector<std::byte> partial;
+
+    for (auto& archetype : archetypes.archetypes()) {
+        auto length = archetype.length();
+        auto chunked = archetype.storage() == ArchetypeStorage::Chunked;
+
+        ArchetypeRecord record = {
+            .length = length,
+            .columnCount = archetype.columnCount(),
+            .chunkRows = archetype.chunkRows(),
+            .blockCount = chunked && length > 0 ? archetype.chunkCount() : 0,
+            .blockBytes = archetype.blockBytes(),
+            .storage = std::uint8_t(archetype.storage()),
+        };
+        std::copy(std::begin(archetype.bitmask().words), std::end(archetype.bitmask().words), record.bitmask);
+        writer.write(&record, 1);
+        writer.write(archetype.entityData(), length);
+
+        if (chunked && record.blockBytes > 0) {
+            // Blocks are written whole so the loader can use them in place. The last one is copied row range
+            // by row range first, leaving its unused rows zeroed.
+            auto full = length / record.chunkRows;
+
+            for (std::size_t block = 0; block < full; ++block) {
+                writer.write(archetype.block(block), record.blockBytes);
+            }
+
+            if (full < record.blockCount) {
+                auto rows = length - full * record.chunkRows;
+                partial.assign(record.blockBytes, std::byte{0});
+
+                for (std::size_t i = 0; i < archetype.columnCount(); ++i) {
+                    auto column = archetype.columnAt(i);
+                    auto offset = column->page(full) - archetype.block(full);
+                    std::memcpy(partial.data() + offset, column->page(full), rows * column->typeInfo().size);
+                }
+
+                writer.write(partial.data(), partial.size());
+            }
+        } else if (!chunked) {
+            for (std::size_t i = 0; i < archetype.columnCount(); ++i) {
+                auto column = archetype.columnAt(i);
+                writer.write(column->data(), length * column->typeInfo().size);
+            }
+        }
+
+        for (std::size_t i = 0; i < archetype.columnCount(); ++i) {
+            writeTicks(writer, *archetype.columnAt(i));
+        }
+    }
+
+    components.sparse().forEach([&](component_id id) {
+        auto set = archetypes.sparseSet(id);
+        auto& dense = set->dense();
+
+        SparseRecord record = {
+            .component = id,
+            .length = set->length(),
+        };
+        writer.write(&record, 1);
+        writer.write(set->entities().data(), record.length);
+        writer.write(dense.data(), record.length * dense.typeInfo().size);
+        writeTicks(writer, dense);
+    });
+
+    writer.close();
+}
+
+void loadSnapshot(World& world, const std::filesystem::path& path, SnapshotLoad mode) {
+    auto file = std::make_shared<MappedFile>(path);
+    SnapshotReader reader(*file);
+
+    auto& header = *reader.take<SnapshotHeader>(1);
+
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) {
+        throw std::runtime_error("Not a snapshot file: " + path.string());
+    }
+
+    if (header.version != snapshotVersion || header.signatureWords != Signature::wordCount ||
+        header.chunkSize != Archetype::chunkSize) {
+        throw std::runtime_error("Snapshot was written by an incompatible version");
+    }
+
+    auto& archetypes = world.archetypes;
+
+    if (!world.entities.generationData().empty() || archetypes.length() != 1) {
+        throw std::runtime_error("Snapshots can only be loaded into a world without entities");
+    }
+
+    validateSnapshot(world, reader, header);
+
+    reader.take<ComponentRecord>(header.componentCount);
+    auto pairs = reader.take<RelationPair>(header.pairCount);
+    auto pairFree = reader.take<component_id>(header.pairFreeCount);
+
+    // Registers the ids the saved world created for pairs. Validates the pairs before changing anything.
+    world.restorePairs({pairs, header.pairCount}, {pairFree, header.pairFreeCount});
+
+    auto generations = reader.take<EntityGeneration>(header.entityCount);
+    auto locations = reader.take<std::uint32_t>(header.entityCount);
+    auto rows = reader.take<std::uint32_t>(header.entityCount);
+    auto free = reader.take<EntityId>(header.freeCount);
+
+    world.entities.restore(
+        {generations, header.entityCount},
+        {locations, header.entityCount},
+        {rows, header.entityCount},
+        {free, header.freeCount}
+    );
+
+    auto tick = Tick(header.changeTick);
+
+    for (std::size_t index = 0; index < header.archetypeCount; ++index) {
+        auto& record = *reader.take<ArchetypeRecord>(1);
+
+        Signature bitmask;
+        std::copy(std::begin(record.bitmask), std::end(record.bitmask), bitmask.words);
+
+        auto archetype = archetypes.getOrCreate(bitmask);
+        assert(archetypes.position(bitmask) == index);
+
+        auto storage = ArchetypeStorage(record.storage);
+        if (archetype->storage() != storage) {
+            archetype->setStorage(storage);
+        }
+
+        auto length = std::size_t(record.length);
+        auto entities = reader.take<Entity>(length);
+
+        if (storage == ArchetypeStorage::Chunked) {
+            auto blocks = reader.take<std::byte>(record.blockCount * record.blockBytes);
+
+            // Adopted blocks already cover every row, so growing allocates nothing.
+            if (mode == SnapshotLoad::Adopt && record.blockCount > 0) {
+                archetype->adoptBlocks(blocks, record.blockCount, file);
+                archetype->growBatch(entities, length, tick);
+            } else {
+                archetype->growBatch(entities, length, tick);
+
+                for (std::size_t block = 0; block < record.blockCount && record.blockBytes > 0; ++block) {
+                    std::memcpy(archetype->block(block), blocks + block * record.blockBytes, record.blockBytes);
+                }
+            }
+        } else {
+            archetype->growBatch(entities, length, tick);
+
+            for (std::size_t i = 0; i < archetype->columnCount(); ++i) {
+                auto column = archetype->columnAt(i);
+                auto bytes = reader.take<std::byte>(length * column->typeInfo().size);
+
+                if (length > 0) {
+                    std::memcpy(column->data(), bytes, length * column->typeInfo().size);
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < archetype->columnCount(); ++i) {
+            readTicks(reader, *archetype->columnAt(i), length);
+        }
+    }
+
+    for (std::size_t index = 0; index < header.sparseCount; ++index) {
+        auto& record = *reader.take<SparseRecord>(1);
+        auto set = archetypes.sparseSet(component_id(record.component));
+        auto length = std::size_t(record.length);
+        auto size = set->dense().typeInfo().size;
+        auto entities = reader.take<Entity>(length);
+        auto bytes = reader.take<std::byte>(length * size);
+
+        for (std::size_t row = 0; row < length; ++row) {
+            set->insert(entities[row], bytes + row * size, tick);
+        }
+
+        readTicks(reader, set->dense(), length);
+    }
+
+    world.setChangeTick(tick);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+class World;
+
+/// Version of the snapshot format, bumped whenever the layout changes. Files of other versions are rejected.
+constexpr std::uint32_t snapshotVersion = 2;
+
+/// How a snapshot's column memory ends up in the world.
+enum class SnapshotLoad : std::uint8_t {
+    /// Copies every column out of the mapped file, which is unmapped once loading returns.
+    Copy,
+    /// Chunked archetypes use the file's blocks in place. The file is mapped copy-on-write, so writes never
+    /// reach it, and stays mapped while any archetype holds its blocks. Contiguous columns are still copied.
+    Adopt,
+};
+
+/// Writes the world to a snapshot file: the pair registry and entity metadata, then the signature, entities,
+/// raw column bytes and ticks of every archetype, then every sparse set. Every array starts on a 64-byte boundary, so the
+/// file can be mapped and its blocks used in place. Components are stored as raw bytes and must be
+/// trivially copyable. Throws when a component with rows isn't trivially relocatable, or when the file
+/// can't be written. Reserved entities are flushed first, pending commands are not part of the snapshot.
+void saveSnapshot(World& world, const std::filesystem::path& path);
+
+/// Restores a snapshot into a world without entities, whose components and relations were registered in the
+/// same order as in the saved world. Pair ids are registered from the snapshot. Rows are restored per column with a single copy, or none when adopted, and entities
+/// keep their handles and ticks. Throws when the file isn't a snapshot of this version, is truncated, or when
+/// the components or the world don't match. Every record is checked before anything is restored, so a failed
+/// load leaves the world as it was.
+void loadSnapshot(World& world, const std::filesystem::path& path, SnapshotLoad mode = SnapshotLoad::Copy);
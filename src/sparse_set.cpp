@@ -0,0 +1,84 @@
+#include "sparse_set.hpp"
+
+SparseSet::SparseSet(TypeInfo typeInfo) : _dense(typeInfo) {}
+
+bool SparseSet::contains(EntityId id) const {
+    return this->row(id) != npos;
+}
+
+std::byte* SparseSet::get(EntityId id) {
+    auto row = this->row(id);
+    return row == npos ? nullptr : this->_dense.get(row);
+}
+
+void SparseSet::insert(Entity entity, std::byte* bytes, Tick tick) {
+    auto row = this->row(entity.id);
+
+    if (row != npos) {
+        this->_dense.replace(row, bytes);
+        this->_dense.markChanged(row, 1, tick);
+        return;
+    }
+
+    this->_dense.grow(1, tick);
+    this->_dense.set(this->_dense.length() - 1, bytes);
+    this->_entities.push_back(entity);
+    this->setRow(entity.id, this->_entities.size() - 1);
+}
+
+bool SparseSet::remove(EntityId id) {
+    auto row = this->row(id);
+
+    if (row == npos) {
+        return false;
+    }
+
+    auto info = this->_dense.typeInfo();
+    info.destructor(this->_dense.swapRemove(row));
+
+    auto last = this->_entities.back();
+    this->_entities[row] = last;
+    this->_entities.pop_back();
+
+    if (last.id != id) {
+        this->setRow(last.id, row);
+    }
+
+    this->setRow(id, npos);
+    return true;
+}
+
+void SparseSet::clear() {
+    for (auto entity : this->_entities) {
+        this->setRow(entity.id, npos);
+    }
+
+    this->_dense.clear();
+    this->_entities.clear();
+}
+
+std::size_t SparseSet::length() const {
+    return this->_entities.size();
+}
+
+const std::vector<Entity>& SparseSet::entities() const {
+    return this->_entities;
+}
+
+BlobVector& SparseSet::dense() {
+    return this->_dense;
+}
+
+void SparseSet::setRow(EntityId id, std::size_t row) {
+    auto page = id / pageSize;
+
+    if (page >= this->_sparse.size()) {
+        this->_sparse.resize(page + 1);
+    }
+
+    if (!this->_sparse[page]) {
+        this->_sparse[page] = std::make_unique<std::size_t[]>(pageSize);
+    }
+
+    this->_sparse[page][id % pageSize] = row + 1;
+}
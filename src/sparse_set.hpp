@@ -0,0 +1,61 @@
+#pragma once
+
+#include "blob_vector.hpp"
+#include "entity.hpp"
+#include "tick.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/// Storage of a sparse component, kept outside the archetypes. Components and their entities are packed in
+/// dense arrays, found through a table indexed by entity id whose pages are allocated on first use. Inserting
+/// or removing a component never moves the entity's other components.
+class SparseSet {
+public:
+    static constexpr std::size_t npos = std::size_t(-1);
+    /// Entity ids covered by a page of the sparse table.
+    static constexpr std::size_t pageSize = 4096;
+
+    explicit SparseSet(TypeInfo typeInfo);
+
+    /// Returns the row of the entity's component in the dense arrays, or `npos` without one.
+    [[nodiscard]] std::size_t row(EntityId id) const {
+        auto page = id / pageSize;
+
+        if (page >= this->_sparse.size() || !this->_sparse[page]) {
+            return npos;
+        }
+
+        // Rows are stored one up, so zeroed pages read as npos.
+        return this->_sparse[page][id % pageSize] - 1;
+    }
+
+    [[nodiscard]] bool contains(EntityId id) const;
+
+    /// Returns the entity's component, or null without one.
+    [[nodiscard]] std::byte* get(EntityId id);
+
+    /// Move constructs the entity's component from the bytes, added at the tick. An existing component is
+    /// replaced instead and marked as changed.
+    void insert(Entity entity, std::byte* bytes, Tick tick);
+
+    /// Destroys the entity's component, filling its row with the last one. Returns whether there was one.
+    bool remove(EntityId id);
+
+    /// Destroys every component.
+    void clear();
+
+    [[nodiscard]] std::size_t length() const;
+    /// Returns the entity of every row.
+    [[nodiscard]] const std::vector<Entity>& entities() const;
+    /// Returns the components and their ticks, row by row.
+    [[nodiscard]] BlobVector& dense();
+
+private:
+    void setRow(EntityId id, std::size_t row);
+
+    BlobVector _dense;
+    std::vector<Entity> _entities;
+    std::vector<std::unique_ptr<std::size_t[]>> _sparse;
+};
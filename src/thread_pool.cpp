@@ -0,0 +1,169 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local std::size_t currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    if (threadCount == 0) {
+        auto hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (std::size_t i = 0; i < threadCount + 1; ++i) {
+        this->_queues.push_back(std::make_unique<Queue>());
+    }
+
+    this->_threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        this->_threads.emplace_back([this, i]() { this->workerLoop(i); });
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t minBatch, const RangeFunc& func) {
+    if (count == 0) {
+        return;
+    }
+
+    minBatch = std::max<std::size_t>(minBatch, 1);
+
+    if (count <= minBatch) {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<std::size_t> remaining = count;
+
+    // The calling thread splits the first task itself, handing halves to the pool as it goes.
+    this->run(this->currentQueue(), Task{ &func, &remaining, minBatch, 0, count });
+    this->wait(remaining);
+}
+
+void ThreadPool::submit(std::size_t count, std::size_t minBatch, const RangeFunc& func, std::atomic<std::size_t>& remaining) {
+    if (count == 0) {
+        return;
+    }
+
+    this->push(this->currentQueue(), Task{ &func, &remaining, std::max<std::size_t>(minBatch, 1), 0, count });
+}
+
+void ThreadPool::wait(const std::atomic<std::size_t>& remaining) {
+    auto queue = this->currentQueue();
+
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        Task task;
+
+        if (this->pop(queue, task) || this->steal(queue, task)) {
+            this->run(queue, task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::size_t ThreadPool::threadCount() const {
+    return this->_threads.size();
+}
+
+std::size_t ThreadPool::threadIndex() const {
+    return this->currentQueue();
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        Task task;
+
+        if (this->pop(index, task) || this->steal(index, task)) {
+            this->run(index, task);
+            continue;
+        }
+
+        std::unique_lock lock(this->_sleepMutex);
+        this->_wake.wait(lock, [this]() {
+            return this->_stop.load() || this->_pending.load() != 0;
+        });
+
+        if (this->_stop.load()) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::push(std::size_t queue, Task task) {
+    {
+        std::lock_guard lock(this->_queues[queue]->mutex);
+        this->_queues[queue]->tasks.push_back(task);
+    }
+
+    {
+        std::lock_guard lock(this->_sleepMutex);
+        this->_pending.fetch_add(1);
+    }
+    this->_wake.notify_one();
+}
+
+bool ThreadPool::pop(std::size_t queue, Task& task) {
+    std::lock_guard lock(this->_queues[queue]->mutex);
+    auto& tasks = this->_queues[queue]->tasks;
+
+    if (tasks.empty()) {
+        return false;
+    }
+
+    task = tasks.back();
+    tasks.pop_back();
+    this->_pending.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t thief, Task& task) {
+    const auto queueCount = this->_queues.size();
+
+    for (std::size_t offset = 1; offset < queueCount; ++offset) {
+        auto& victim = *this->_queues[(thief + offset) % queueCount];
+        std::lock_guard lock(victim.mutex);
+
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            this->_pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(std::size_t queue, Task task) {
+    // Keep the lower half and publish the upper half until the range fits in a single batch.
+    while (task.end - task.begin >= task.minBatch * 2) {
+        auto middle = task.begin + (task.end - task.begin) / 2;
+        this->push(queue, Task{ task.func, task.remaining, task.minBatch, middle, task.end });
+        task.end = middle;
+    }
+
+    (*task.func)(task.begin, task.end);
+    task.remaining->fetch_sub(task.end - task.begin, std::memory_order_release);
+}
+
+std::size_t ThreadPool::currentQueue() const {
+    return currentPool == this ? currentWorker : this->_threads.size();
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(this->_sleepMutex);
+        this->_stop.store(true);
+    }
+    this->_wake.notify_all();
+
+    for (auto& thread : this->_threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work-stealing thread pool. Every worker owns a deque: it pops its own work from the back and steals
+/// from the front of other deques when it runs dry. Threads outside the pool submit through a shared
+/// injector deque and help executing until their job is done, so nested calls from workers don't deadlock.
+class ThreadPool {
+public:
+    using RangeFunc = std::function<void(std::size_t begin, std::size_t end)>;
+
+    /// Creates the pool with the given number of workers. Zero picks the hardware concurrency minus the
+    /// calling thread, which takes part in every job it submits.
+    explicit ThreadPool(std::size_t threadCount = 0);
+
+    /// Calls `func` over [0, count) split into ranges of at least `minBatch` items and blocks until every
+    /// range is done. Ranges are split by halving, so batch boundaries don't depend on thread timing.
+    void parallelFor(std::size_t count, std::size_t minBatch, const RangeFunc& func);
+
+    /// Queues `func` over [0, count) without waiting. Every finished item is subtracted from `remaining`,
+    /// which the caller has to account for beforehand. `func` and `remaining` must outlive the work.
+    void submit(std::size_t count, std::size_t minBatch, const RangeFunc& func, std::atomic<std::size_t>& remaining);
+
+    /// Executes queued work on the calling thread until `remaining` drops to zero.
+    void wait(const std::atomic<std::size_t>& remaining);
+
+    std::size_t threadCount() const;
+
+    /// Returns the index of the calling thread: the worker's index inside the pool, or `threadCount()` for
+    /// every thread outside of it.
+    std::size_t threadIndex() const;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+private:
+    struct Task {
+        const RangeFunc* func;
+        std::atomic<std::size_t>* remaining;
+        std::size_t minBatch;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(std::size_t index);
+    void push(std::size_t queue, Task task);
+    bool pop(std::size_t queue, Task& task);
+    bool steal(std::size_t thief, Task& task);
+    void run(std::size_t queue, Task task);
+    std::size_t currentQueue() const;
+
+    std::vector<std::thread> _threads;
+    /// One queue per worker followed by the injector queue shared by outside threads.
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<std::size_t> _pending = 0;
+    std::atomic<bool> _stop = false;
+};
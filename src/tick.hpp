@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+/// World time used by change detection. Ticks wrap around, so they are only ever compared with ticks
+/// less than half the range apart.
+using Tick = std::uint32_t;
+
+/// When a component was added to its entity and when it was last accessed mutably.
+struct ComponentTicks {
+    Tick added;
+    Tick changed;
+};
+
+/// Change ticks summarizing a page of rows, or the whole vector when it isn't paged.
+struct PageTicks {
+    /// Latest tick at which a row was added or changed. Change filters skip the page when it's old.
+    Tick latest = 0;
+    /// Tick at which every row of the page was changed at once, by a mutable query. It's merged into the
+    /// rows' own ticks before rows move, so marking a whole page doesn't write every row.
+    Tick bulk = 0;
+    bool hasBulk = false;
+};
+
+/// Returns whether `tick` happened after `lastRun`, as seen from `thisRun`. Ages are compared instead of
+/// raw values, which keeps the answer right when the counter wraps around.
+constexpr bool isNewerTick(Tick tick, Tick lastRun, Tick thisRun) {
+    return Tick(thisRun - tick) < Tick(thisRun - lastRun);
+}
+
+/// Returns the later of two ticks.
+constexpr Tick latestTick(Tick lhs, Tick rhs) {
+    return Tick(rhs - lhs) < (Tick(1) << 31) ? rhs : lhs;
+}
+
+/// Ticks the world advances between passes over its stored ticks, see World::checkChangeTicks.
+constexpr Tick tickCheckInterval = Tick(1) << 28;
+/// Age passes pull older ticks up to. Stored ticks stay younger than `maxTickAge + tickCheckInterval`
+/// between passes, under half the range, so their ages never wrap around.
+constexpr Tick maxTickAge = Tick(1) << 30;
+
+/// Returns the tick, or the tick `maxTickAge` before `thisRun` when it's older. Changes older than that
+/// can't be told apart anymore and count as made at the same time as a last run that old.
+constexpr Tick clampTick(Tick tick, Tick thisRun) {
+    return Tick(thisRun - tick) > maxTickAge ? Tick(thisRun - maxTickAge) : tick;
+}
+
+/// Last run of change filters that never ran, older than every stored tick, so every row counts as new.
+constexpr Tick firstRunTick(Tick thisRun) {
+    return Tick(thisRun - (Tick(1) << 31));
+}
+
+/// Advances `passes` check intervals past a row changed at `changed` and a filter last run at `lastRun`,
+/// clamping both at every pass like World::checkChangeTicks, then returns whether the row counts as newer.
+constexpr bool isNewerAfterPasses(Tick changed, Tick lastRun, unsigned passes) {
+    auto thisRun = latestTick(changed, lastRun);
+
+    for (unsigned pass = 0; pass < passes; ++pass) {
+        thisRun += tickCheckInterval;
+        changed = clampTick(changed, thisRun);
+        lastRun = clampTick(lastRun, thisRun);
+    }
+
+    return isNewerTick(changed, lastRun, thisRun);
+}
+
+// A row changed before the last run, 15 intervals later once the tick wrapped past it: unclamped it counts
+// as newer, clamped it doesn't. Rows changed after the last run stay newer.
+static_assert(isNewerTick(Tick(5), Tick(6) + tickCheckInterval, Tick(6) + tickCheckInterval * 16));
+static_assert(!isNewerAfterPasses(Tick(5), Tick(6) + tickCheckInterval, 15));
+static_assert(!isNewerAfterPasses(Tick(-5), Tick(3), 32));
+static_assert(isNewerAfterPasses(Tick(7), Tick(5), 3));
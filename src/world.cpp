@@ -1,97 +1,925 @@
 #include "world.hpp"
 #include "entity.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <optional>
 #include <print>
+#include <unordered_set>
+
+namespace {
+    /// Outside buffer the thread recorded into last, so repeated calls skip the registry lock.
+    struct OutsideBufferCache {
+        std::uint64_t serial = 0;
+        CommandBuffer* buffer = nullptr;
+    };
+
+    thread_local OutsideBufferCache outsideBufferCache;
+    std::atomic<std::uint64_t> nextOutsideSerial = 1;
+}
 
 World::World() {
+    this->_outsideSerial = nextOutsideSerial.fetch_add(1, std::memory_order_relaxed);
     this->components = std::make_shared<Components>();
-    this->entities = Entities();
     this->archetypes = Archetypes(this->components);
 }
 
+Tick World::changeTick() const {
+    return this->_changeTick.load(std::memory_order_relaxed);
+}
+
+Tick World::incrementChangeTick() {
+    return this->_changeTick.fetch_add(1, std::memory_order_relaxed);
+}
+
+void World::setChangeTick(Tick tick) {
+    this->_changeTick.store(tick, std::memory_order_relaxed);
+}
+
+void World::checkChangeTicks() {
+    auto thisRun = this->changeTick();
+
+    if (Tick(thisRun - this->_lastTickCheck) < tickCheckInterval) {
+        return;
+    }
+
+    this->_lastTickCheck = thisRun;
+
+    for (auto& archetype : this->archetypes.archetypes()) {
+        for (std::size_t i = 0; i < archetype.columnCount(); ++i) {
+            archetype.columnAt(i)->clampTicks(thisRun);
+        }
+    }
+
+    this->components->sparse().forEach([&](component_id id) {
+        this->archetypes.sparseSet(id)->dense().clampTicks(thisRun);
+    });
+
+    for (auto& query : this->_queries) {
+        if (query) {
+            query->clampTicks(thisRun);
+        }
+    }
+}
+
+ThreadPool& World::threadPool() {
+    if (!this->_threadPool) {
+        this->setThreadCount(0);
+    }
+
+    return *this->_threadPool;
+}
+
+void World::setThreadCount(std::size_t threadCount) {
+    this->flush();
+
+    this->_threadPool = std::make_unique<ThreadPool>(threadCount);
+    this->_commandBuffers.clear();
+
+    for (std::size_t i = 0; i < this->_threadPool->threadCount(); ++i) {
+        this->_commandBuffers.push_back(std::make_unique<CommandBuffer>(this->components, &this->entities));
+    }
+}
+
+CommandBuffer& World::commands() {
+    if (this->_threadPool) {
+        auto index = this->_threadPool->threadIndex();
+
+        if (index < this->_commandBuffers.size()) {
+            return *this->_commandBuffers[index];
+        }
+    }
+
+    if (outsideBufferCache.serial == this->_outsideSerial) {
+        return *outsideBufferCache.buffer;
+    }
+
+    std::lock_guard lock(this->_outsideMutex);
+
+    auto thread = std::this_thread::get_id();
+    auto found = std::ranges::find(this->_outsideBuffers, thread, &decltype(this->_outsideBuffers)::value_type::first);
+
+    if (found == this->_outsideBuffers.end()) {
+        this->_outsideBuffers.emplace_back(thread, std::make_unique<CommandBuffer>(this->components, &this->entities));
+        found = std::prev(this->_outsideBuffers.end());
+    }
+
+    outsideBufferCache = OutsideBufferCache{ this->_outsideSerial, found->second.get() };
+    return *found->second;
+}
+
+Entity World::reserveEntity() {
+    return this->entities.reserve();
+}
+
+void World::flush() {
+    this->entities.flush();
+    this->checkChangeTicks();
+
+    CommandBuffer* merged = nullptr;
+
+    auto merge = [&](CommandBuffer& buffer) {
+        if (merged == nullptr) {
+            merged = &buffer;
+        } else {
+            merged->append(std::move(buffer));
+        }
+    };
+
+    for (auto& buffer : this->_commandBuffers) {
+        merge(*buffer);
+    }
+
+    for (auto& [thread, buffer] : this->_outsideBuffers) {
+        merge(*buffer);
+    }
+
+    if (merged != nullptr) {
+        merged->apply(*this);
+    }
+}
+
 std::byte* World::get(Entity entity, component_id componentId) {
+    if (auto set = this->archetypes.sparseSet(componentId)) {
+        auto row = set->row(entity.id);
+
+        if (row == SparseSet::npos) {
+            return nullptr;
+        }
+
+        set->dense().markChanged(row, 1, this->changeTick());
+        return set->dense().get(row);
+    }
+
     auto location = this->entities.getLocation(entity).value();
     auto archetype = this->archetypes.at(location.archetype);
+
+    if (this->components->tags().test(componentId)) {
+        return archetype->bitmask().test(componentId) ? tagAddress() : nullptr;
+    }
+
     auto column = archetype->getColumn(componentId);
+
+    column->markChanged(location.row, 1, this->changeTick());
     return column->get(location.row);
 }
 
+void World::setHook(component_id id, ComponentEvent event, ComponentHook hook) {
+    assert(this->components->isRegistered(id));
+    assert((event != ComponentEvent::Replace || !this->components->tags().test(id)) && "Tags have no values to replace");
+
+    auto& hooks = this->_hooks[std::size_t(event)];
+    auto& hooked = this->_hooked[std::size_t(event)];
+
+    if (id >= hooks.size()) {
+        hooks.resize(id + 1);
+    }
+
+    if (hook) {
+        hooked.set(id);
+    } else {
+        hooked.reset(id);
+    }
+
+    hooks[id] = std::move(hook);
+    this->_anyHooked = this->_hooked[0] | this->_hooked[1] | this->_hooked[2];
+}
+
+void World::callHooks(ComponentEvent event, const Signature& bitmask, std::span<const Entity> entities) {
+    auto& hooks = this->_hooks[std::size_t(event)];
+
+    if (entities.empty()) {
+        return;
+    }
+
+    (bitmask & this->_hooked[std::size_t(event)]).forEach([&](component_id id) {
+        auto set = this->archetypes.sparseSet(id);
+
+        if (set == nullptr) {
+            hooks[id](*this, id, entities);
+            return;
+        }
+
+        std::vector<Entity> owners;
+        std::ranges::copy_if(entities, std::back_inserter(owners), [&](Entity entity) {
+            return set->contains(entity.id);
+        });
+
+        if (!owners.empty()) {
+            hooks[id](*this, id, owners);
+        }
+    });
+}
+
+void World::callHooks(ComponentEvent event, component_id id, const std::vector<BatchRange>& ranges) {
+    for (const auto& range : ranges) {
+        auto archetype = this->archetypes.at(range.archetype);
+        this->callHooks(event, Signature::of(id), std::span<const Entity>(archetype->entityData() + range.row, range.count));
+    }
+}
+
+Signature World::componentsOf(Entity entity, const Signature& bitmask) {
+    Signature components;
+
+    if (auto location = this->entities.getLocation(entity)) {
+        components = this->archetypes.at(location->archetype)->bitmask() & bitmask;
+    }
+
+    (bitmask & this->archetypes.sparseMask()).forEach([&](component_id id) {
+        if (this->archetypes.sparseSet(id)->contains(entity.id)) {
+            components.set(id);
+        }
+    });
+
+    return components;
+}
+
 Entity World::spawnEmpty() {
     auto entity = this->entities.create();
     return entity;
 }
 
 Entity World::spawnBundle(std::unique_ptr<Bundle> bundle) {
+    return this->spawnBundle(*bundle);
+}
+
+Entity World::spawnBundle(const Bundle& bundle) {
     auto entity = this->entities.create();
-    this->insertBundle(entity, std::move(bundle));
+    this->insertBundle(entity, bundle);
     return entity;
 }
 
-void World::insertBundle(Entity entity, std::unique_ptr<Bundle> bundle) {
-    auto oldLocation = this->entities.getLocation(entity);
-    auto oldBitmask = 0;
+void World::spawnBatch(const Signature& bitmask, std::size_t count, std::byte* const* columns, Entity* out) {
+    std::size_t row = 0;
+    auto archetype = this->allocateBatch(bitmask, count, out, row);
 
-    if (oldLocation.has_value()) {
-        oldBitmask = this->archetypes.at(oldLocation.value().archetype)->bitmask();
+    if (archetype == nullptr) {
+        return;
     }
 
-    auto targetBitmask = oldBitmask | bundle->bitmask;
-    auto targetArchetype = this->archetypes.getOrCreate(targetBitmask);
+    std::size_t index = 0;
+    bitmask.forEach([&](component_id id) {
+        auto bytes = columns[index++];
 
-    if (targetBitmask != oldBitmask) {
-        if (!this->entities.isEmpty(entity)) {
-            this->archetypes.moveEntity(entity, oldBitmask, targetBitmask, &this->entities);
-        } else {
-            auto target = this->archetypes.get(targetBitmask);
-            auto targetPosition = this->archetypes.position(targetBitmask);
+        if (this->components->tags().test(id)) {
+            return;
+        }
 
-            target->grow(entity);
+        if (auto set = this->archetypes.sparseSet(id)) {
+            auto size = set->dense().typeInfo().size;
 
-            auto row = target->length() - 1;
-            this->entities.setLocation(entity, EntityLocation{targetPosition, row});
+            for (std::size_t i = 0; i < count; ++i) {
+                set->insert(out[i], bytes + i * size, this->changeTick());
+            }
+        } else {
+            archetype->getColumn(id)->setRange(row, bytes, count);
         }
+    });
+
+    if (this->hasHooks(ComponentEvent::Add, bitmask)) [[unlikely]] {
+        this->callHooks(ComponentEvent::Add, bitmask, std::span<const Entity>(out, count));
+    }
+}
+
+Archetype* World::allocateBatch(const Signature& bitmask, std::size_t count, Entity* out, std::size_t& row) {
+    this->entities.createBatch(count, out);
+
+    // Entities without components stay out of the archetypes, like after spawnEmpty.
+    if (bitmask.empty()) {
+        return nullptr;
+    }
+
+    const auto& edge = this->archetypes.insertEdge(Archetypes::root, bitmask & ~this->archetypes.sparseMask());
+    auto archetype = this->archetypes.at(edge.target);
+
+    row = archetype->length();
+    archetype->growBatch(out, count, this->changeTick());
+
+    for (std::size_t i = 0; i < count; ++i) {
+        this->entities.setLocation(out[i], EntityLocation{ edge.target, row + i });
+    }
+
+    return archetype;
+}
+
+void World::locate(Entity entity) {
+    if (!this->entities.isEmpty(entity)) {
+        return;
     }
 
-    auto targetLocation = this->entities.getLocation(entity).value();
+    auto root = this->archetypes.at(Archetypes::root);
+    root->grow(entity, this->changeTick());
+    this->entities.setLocation(entity, EntityLocation{ Archetypes::root, root->length() - 1 });
+}
+
+EntityLocation World::prepareInsert(Entity entity, const Signature& bitmask, Signature& previous) {
+    auto oldLocation = this->entities.getLocation(entity);
+    auto from = oldLocation.has_value() ? oldLocation.value().archetype : Archetypes::root;
+    previous = this->archetypes.at(from)->bitmask();
+
+    const auto& edge = this->archetypes.insertEdge(from, bitmask & ~this->archetypes.sparseMask());
 
-    bundle->transfer([&](component_id bit, std::byte* bytes) {
-        auto targetColumn = targetArchetype->getColumn(bit);
+    if (!oldLocation.has_value()) {
+        auto targetArchetype = this->archetypes.at(edge.target);
+        targetArchetype->grow(entity, this->changeTick());
 
-        if ((oldBitmask & bit) != 0) {
-            targetColumn->replace(targetLocation.row, bytes);
+        auto location = EntityLocation{edge.target, targetArchetype->length() - 1};
+        this->entities.setLocation(entity, location);
+        return location;
+    }
+
+    if (edge.target != from) {
+        this->archetypes.moveEntity(entity, edge, &this->entities, this->changeTick());
+    }
+
+    return this->entities.getLocation(entity).value();
+}
+
+void World::insertBundle(Entity entity, std::unique_ptr<Bundle> bundle) {
+    this->insertBundle(entity, *bundle);
+}
+
+void World::insertBundle(Entity entity, const Bundle& bundle) {
+    auto hooked = this->hasHooks(bundle.bitmask);
+    Signature had;
+
+    if (hooked) [[unlikely]] {
+        had = this->componentsOf(entity, bundle.bitmask);
+        this->callHooks(ComponentEvent::Replace, had, std::span(&entity, 1));
+    }
+
+    Signature previous;
+    auto location = this->prepareInsert(entity, bundle.bitmask, previous);
+    auto archetype = this->archetypes.at(location.archetype);
+
+    bundle.transfer([&](component_id id, std::byte* bytes) {
+        if (auto set = this->archetypes.sparseSet(id)) {
+            set->insert(entity, bytes, this->changeTick());
+            return;
+        }
+
+        auto column = archetype->getColumn(id);
+
+        if (previous.test(id)) {
+            column->replace(location.row, bytes);
+            column->markChanged(location.row, 1, this->changeTick());
         } else {
-            targetColumn->set(targetLocation.row, bytes);
+            column->set(location.row, bytes);
         }
     });
+
+    if (hooked) [[unlikely]] {
+        this->callHooks(ComponentEvent::Add, bundle.bitmask & ~had, std::span(&entity, 1));
+    }
 }
 
 void World::removeBundle(Entity entity, std::unique_ptr<Bundle> bundle) {
+    this->removeComponents(entity, bundle->bitmask);
+}
+
+void World::removeComponents(Entity entity, const Signature& bitmask) {
     auto oldLocation = this->entities.getLocation(entity);
 
     if (!oldLocation.has_value()) {
         return;
     }
 
-    auto oldBitmask = this->archetypes.at(oldLocation.value().archetype)->bitmask();
-    auto targetBitmask = oldBitmask & ~bundle->bitmask;
+    if (this->hasHooks(ComponentEvent::Remove, bitmask)) [[unlikely]] {
+        this->callHooks(ComponentEvent::Remove, this->componentsOf(entity, bitmask), std::span(&entity, 1));
+    }
 
-    this->archetypes.getOrCreate(targetBitmask);
-    this->archetypes.moveEntity(entity, oldBitmask, targetBitmask, &this->entities);
-}
+    auto sparse = bitmask & this->archetypes.sparseMask();
 
+    sparse.forEach([&](component_id id) {
+        this->archetypes.sparseSet(id)->remove(entity.id);
+    });
+
+    auto from = oldLocation.value().archetype;
+    const auto& edge = this->archetypes.removeEdge(from, bitmask & ~sparse);
+
+    if (edge.target != from) {
+        this->archetypes.moveEntity(entity, edge, &this->entities, this->changeTick());
+    }
+}
 
 void World::despawn(Entity entity) {
     if (!this->entities.isAlive(entity)) {
         throw std::runtime_error("Entity is not alive while trying to despawn it");
     }
 
+    if (!this->entities.isEmpty(entity)) {
+        if (!this->_hooked[std::size_t(ComponentEvent::Remove)].empty()) [[unlikely]] {
+            auto location = this->entities.getLocation(entity).value();
+            auto bitmask = this->archetypes.at(location.archetype)->bitmask() | this->archetypes.sparseMask();
+            this->callHooks(ComponentEvent::Remove, bitmask, std::span(&entity, 1));
+        }
+
+        this->archetypes.removeSparse(entity.id);
+        this->archetypes.removeEntity(entity, &this->entities);
+    }
+
+    this->entities.despawn(entity);
+
+    if (!this->relations.empty()) [[unlikely]] {
+        this->releaseTargets(std::span(&entity, 1));
+    }
+}
+
+void World::despawnBatch(std::span<const Entity> entities) {
+    this->_batchRows.clear();
+
+    for (auto entity : entities) {
+        if (!this->entities.isAlive(entity)) {
+            continue;
+        }
+
+        if (this->entities.isEmpty(entity)) {
+            this->entities.despawn(entity);
+            continue;
+        }
+
+        auto location = this->entities.getLocation(entity).value();
+        this->_batchRows.emplace_back(location.archetype, location.row);
+    }
+
+    // Rows of an archetype from the highest down, so swap removal never moves a row that is still pending.
+    std::sort(this->_batchRows.begin(), this->_batchRows.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second > rhs.second;
+    });
+    this->_batchRows.erase(std::unique(this->_batchRows.begin(), this->_batchRows.end()), this->_batchRows.end());
+
+    std::vector<std::size_t> rows;
+
+    for (std::size_t begin = 0; begin < this->_batchRows.size();) {
+        auto index = this->_batchRows[begin].first;
+        auto archetype = this->archetypes.at(index);
+
+        auto end = begin;
+        while (end < this->_batchRows.size() && this->_batchRows[end].first == index) {
+            end++;
+        }
+
+        if (!this->_hooked[std::size_t(ComponentEvent::Remove)].empty()) [[unlikely]] {
+            this->_hookEntities.clear();
+            for (auto i = begin; i < end; ++i) {
+                this->_hookEntities.push_back(archetype->getEntity(this->_batchRows[i].second));
+            }
+
+            this->callHooks(ComponentEvent::Remove, archetype->bitmask() | this->archetypes.sparseMask(), this->_hookEntities);
+        }
+
+        for (auto i = begin; i < end; ++i) {
+            this->archetypes.removeSparse(archetype->getEntity(this->_batchRows[i].second).id);
+        }
+
+        if (end - begin == archetype->length()) {
+            for (std::size_t row = 0; row < archetype->length(); ++row) {
+                this->entities.despawn(archetype->getEntity(row));
+            }
+
+            archetype->clear();
+        } else {
+            rows.clear();
+            for (auto i = begin; i < end; ++i) {
+                rows.push_back(this->_batchRows[i].second);
+                this->entities.despawn(archetype->getEntity(this->_batchRows[i].second));
+            }
+
+            this->archetypes.removeRows(index, rows, &this->entities);
+        }
+
+        begin = end;
+    }
+
+    if (!this->relations.empty()) [[unlikely]] {
+        this->releaseTargets(entities);
+    }
+}
+
+void World::despawnMatching(Query& query) {
+    query.update(&this->archetypes, &this->entities);
+
+    if (!query.requiredSparse().empty()) {
+        std::vector<Entity> matched;
+        this->collectSparseMatching(query, matched);
+        this->despawnBatch(matched);
+        return;
+    }
+
+    std::vector<Entity> targets;
+
+    for (auto index : query.matching()) {
+        auto archetype = this->archetypes.at(index);
+
+        if (!this->relations.empty()) [[unlikely]] {
+            std::copy_if(archetype->entityData(), archetype->entityData() + archetype->length(), std::back_inserter(targets), [&](Entity entity) {
+                return !this->relations.targeting(entity).empty();
+            });
+        }
+
+        if (!this->_hooked[std::size_t(ComponentEvent::Remove)].empty()) [[unlikely]] {
+            auto entities = std::span<const Entity>(archetype->entityData(), archetype->length());
+            this->callHooks(ComponentEvent::Remove, archetype->bitmask() | this->archetypes.sparseMask(), entities);
+        }
+
+        for (std::size_t row = 0; row < archetype->length(); ++row) {
+            this->archetypes.removeSparse(archetype->getEntity(row).id);
+            this->entities.despawn(archetype->getEntity(row));
+        }
+
+        archetype->clear();
+    }
+
+    if (!targets.empty()) [[unlikely]] {
+        this->releaseTargets(targets);
+    }
+}
+
+const std::vector<World::BatchRange>& World::transitionBatch(std::span<const Entity> entities, const Signature& bitmask, bool insert) {
+    this->_batchRows.clear();
+    this->_batchRanges.clear();
+
+    for (auto entity : entities) {
+        if (!this->entities.isAlive(entity)) {
+            continue;
+        }
+
+        if (this->entities.isEmpty(entity)) {
+            if (insert) {
+                const auto& edge = this->archetypes.insertEdge(Archetypes::root, bitmask);
+                auto target = this->archetypes.at(edge.target);
+
+                target->grow(entity, this->changeTick());
+
+                auto row = target->length() - 1;
+                this->entities.setLocation(entity, EntityLocation{edge.target, row});
+                this->_batchRanges.push_back(BatchRange{ edge.target, row, 1 });
+            }
+            continue;
+        }
+
+        auto location = this->entities.getLocation(entity).value();
+        this->_batchRows.emplace_back(location.archetype, location.row);
+    }
+
+    std::sort(this->_batchRows.begin(), this->_batchRows.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second > rhs.second;
+    });
+    this->_batchRows.erase(std::unique(this->_batchRows.begin(), this->_batchRows.end()), this->_batchRows.end());
+
+    for (std::size_t begin = 0; begin < this->_batchRows.size();) {
+        auto index = this->_batchRows[begin].first;
+        auto archetype = this->archetypes.at(index);
+
+        auto end = begin;
+        while (end < this->_batchRows.size() && this->_batchRows[end].first == index) {
+            end++;
+        }
+
+        const auto& edge = insert
+            ? this->archetypes.insertEdge(index, bitmask)
+            : this->archetypes.removeEdge(index, bitmask);
+
+        if (edge.target == index) {
+            begin = end;
+            continue;
+        }
+
+        auto count = end - begin;
+        auto target = this->archetypes.at(edge.target);
+
+        if (!insert && this->hasHooks(ComponentEvent::Remove, bitmask)) [[unlikely]] {
+            this->_hookEntities.clear();
+            for (auto i = begin; i < end; ++i) {
+                this->_hookEntities.push_back(archetype->getEntity(this->_batchRows[i].second));
+            }
+
+            this->callHooks(ComponentEvent::Remove, bitmask & archetype->bitmask(), this->_hookEntities);
+        }
+
+        if (count == archetype->length()) {
+            auto row = this->archetypes.moveAll(index, edge, &this->entities, this->changeTick());
+            this->_batchRanges.push_back(BatchRange{ edge.target, row, count });
+        } else {
+            auto row = target->length();
+            target->reserve(count);
+
+            for (auto i = begin; i < end; ++i) {
+                auto entity = archetype->getEntity(this->_batchRows[i].second);
+                this->archetypes.moveEntity(entity, edge, &this->entities, this->changeTick());
+            }
+
+            this->_batchRanges.push_back(BatchRange{ edge.target, row, count });
+        }
+
+        begin = end;
+    }
+
+    return this->_batchRanges;
+}
+
+const std::vector<World::BatchRange>& World::transitionMatching(Query& query, const Signature& bitmask, bool insert) {
+    this->_batchRanges.clear();
+
+    query.update(&this->archetypes, &this->entities);
+
+    if (!query.requiredSparse().empty()) {
+        std::vector<Entity> matched;
+        this->collectSparseMatching(query, matched);
+        return this->transitionBatch(matched, bitmask, insert);
+    }
+
+    // Transitions may create archetypes matching the query, only those matched up front are moved.
+    this->_batchArchetypes.assign(query.matching().begin(), query.matching().end());
+
+    for (auto index : this->_batchArchetypes) {
+        auto count = this->archetypes.at(index)->length();
+
+        if (count == 0) {
+            continue;
+        }
+
+        const auto& edge = insert
+            ? this->archetypes.insertEdge(index, bitmask)
+            : this->archetypes.removeEdge(index, bitmask);
+
+        if (edge.target == index) {
+            continue;
+        }
+
+        if (!insert && this->hasHooks(ComponentEvent::Remove, bitmask)) [[unlikely]] {
+            auto archetype = this->archetypes.at(index);
+            auto entities = std::span<const Entity>(archetype->entityData(), count);
+            this->callHooks(ComponentEvent::Remove, bitmask & archetype->bitmask(), entities);
+        }
+
+        auto row = this->archetypes.moveAll(index, edge, &this->entities, this->changeTick());
+        this->_batchRanges.push_back(BatchRange{ edge.target, row, count });
+    }
+
+    return this->_batchRanges;
+}
+
+void World::collectSparseMatching(Query& query, std::vector<Entity>& out) {
+    auto required = query.requiredSparse();
+
+    // Updated with the entities, chunks only hold rows of the smallest required set.
+    for (const auto& chunk : query.chunks) {
+        for (std::size_t i = 0; i < chunk.entityCount; ++i) {
+            auto entity = chunk.entities[chunk.rows != nullptr ? chunk.rows[i] : i];
+            bool holds = true;
+
+            required.forEach([&](component_id id) {
+                holds = holds && this->archetypes.sparseSet(id)->contains(entity.id);
+            });
+
+            if (holds) {
+                out.push_back(entity);
+            }
+        }
+    }
+}
+
+component_id World::pair(component_id relation, Entity target) {
+    assert(this->relations.isRelation(relation) && "Component isn't a relation");
+
+    auto id = this->relations.find(relation, target);
+
+    if (id != Relations::none) {
+        return id;
+    }
+
+    if (!this->entities.isAlive(target)) {
+        throw std::runtime_error("Target of a pair is not alive");
+    }
+
+    id = this->relations.reuse();
+
+    if (id == Relations::none) {
+        id = this->registerComponent(this->components->getTypeInfo(relation));
+    }
+
+    this->relations.add(id, relation, target);
+    return id;
+}
+
+void World::addPair(Entity entity, component_id relation, Entity target) {
+    if (!this->entities.isAlive(entity)) {
+        throw std::runtime_error("Entity is not alive while trying to add a pair to it");
+    }
+
+    auto bitmask = Signature::of(this->pair(relation, target));
+    bitmask.set(relation);
+
+    this->insertBundle(entity, Bundle(bitmask));
+}
+
+void World::removePair(Entity entity, component_id relation, Entity target) {
+    auto id = this->relations.find(relation, target);
     auto location = this->entities.getLocation(entity);
+
+    if (id == Relations::none || !location.has_value()) {
+        return;
+    }
+
+    auto bitmask = Signature::of(id);
+    auto held = this->archetypes.at(location->archetype)->bitmask() & this->relations.pairs(relation);
+
+    if (held == bitmask) {
+        bitmask.set(relation);
+    }
+
+    this->removeComponents(entity, bitmask);
+}
+
+std::optional<Entity> World::target(Entity entity, component_id relation, std::size_t index) {
+    auto location = this->entities.getLocation(entity);
+
     if (!location.has_value()) {
+        return std::nullopt;
+    }
+
+    std::optional<Entity> target;
+    auto held = this->archetypes.at(location->archetype)->bitmask() & this->relations.pairs(relation);
+
+    held.forEach([&](component_id id) {
+        if (index-- == 0) {
+            target = this->relations.pair(id).target;
+        }
+    });
+
+    return target;
+}
+
+void World::descendants(component_id relation, Entity root, std::vector<Entity>& out) {
+    this->relations.update(this->archetypes);
+
+    std::unordered_set<EntityId> visited{ root.id };
+
+    auto visit = [&](Entity parent) {
+        auto id = this->relations.find(relation, parent);
+
+        if (id == Relations::none) {
+            return;
+        }
+
+        for (auto index : this->relations.archetypes(id)) {
+            auto archetype = this->archetypes.at(index);
+
+            for (std::size_t row = 0; row < archetype->length(); ++row) {
+                auto child = archetype->getEntity(row);
+
+                if (visited.insert(child.id).second) {
+                    out.push_back(child);
+                }
+            }
+        }
+    };
+
+    auto first = out.size();
+    visit(root);
+
+    // The output doubles as the queue, every level is appended after the one it was found from.
+    for (auto next = first; next < out.size(); ++next) {
+        visit(out[next]);
+    }
+}
+
+void World::ancestors(component_id relation, Entity entity, std::vector<Entity>& out) {
+    std::unordered_set<EntityId> visited{ entity.id };
+
+    auto visit = [&](Entity child) {
+        auto location = this->entities.getLocation(child);
+
+        if (!location.has_value()) {
+            return;
+        }
+
+        (this->archetypes.at(location->archetype)->bitmask() & this->relations.pairs(relation)).forEach([&](component_id id) {
+            auto target = this->relations.pair(id).target;
+
+            if (visited.insert(target.id).second) {
+                out.push_back(target);
+            }
+        });
+    };
+
+    auto first = out.size();
+    visit(entity);
+
+    for (auto next = first; next < out.size(); ++next) {
+        visit(out[next]);
+    }
+}
+
+void World::restorePairs(std::span<const RelationPair> pairs, std::span<const component_id> free) {
+    auto isPair = [&](component_id id) {
+        auto relation = pairs[id].relation;
+
+        return relation != Relations::none && relation < this->components->count() && this->relations.isRelation(relation);
+    };
+
+    if (pairs.size() > Signature::capacity) {
+        throw std::runtime_error("Too many components, raise WECS_MAX_COMPONENTS");
+    }
+
+    for (component_id id = 0; id < pairs.size(); ++id) {
+        auto tag = id >= this->components->count() || this->components->tags().test(id);
+
+        if (pairs[id].relation != Relations::none && (!isPair(id) || !tag)) {
+            throw std::runtime_error("Pairs don't match the world's relations");
+        }
+
+        // Ids past the registry were pairs created in the other world, every other id is registered alike.
+        if (id >= this->components->count() && !isPair(id)) {
+            throw std::runtime_error("Pairs don't match the world's components");
+        }
+    }
+
+    for (auto id : free) {
+        if (id >= pairs.size() || !isPair(id)) {
+            throw std::runtime_error("Pairs don't match the world's relations");
+        }
+    }
+
+    for (auto id = component_id(this->components->count()); id < pairs.size(); ++id) {
+        this->registerComponent(this->components->getTypeInfo(pairs[id].relation));
+    }
+
+    this->relations.restore(pairs, free);
+}
+
+void World::releaseTargets(std::span<const Entity> despawned) {
+    std::vector<component_id> released;
+
+    for (auto entity : despawned) {
+        if (this->entities.isAlive(entity)) {
+            continue;
+        }
+
+        for (auto id : this->relations.targeting(entity)) {
+            if (this->relations.pair(id).target == entity) {
+                released.push_back(id);
+            }
+        }
+    }
+
+    if (released.empty()) {
         return;
     }
-    auto archetype = this->archetypes.at(location.value().archetype);
-    auto bitmask = archetype->bitmask();
 
-    this->removeBundle(entity, std::make_unique<Bundle>(bitmask));
-    this->entities.despawn(entity);
+    // Batches may list an entity more than once.
+    std::ranges::sort(released);
+    released.erase(std::unique(released.begin(), released.end()), released.end());
+
+    std::vector<Entity> cascade;
+
+    for (auto id : released) {
+        auto relation = this->relations.pair(id).relation;
+
+        // Removals below create archetypes, which may hold pairs released later in the loop.
+        this->relations.update(this->archetypes);
+
+        for (auto index : this->relations.archetypes(id)) {
+            auto archetype = this->archetypes.at(index);
+
+            if (archetype->length() == 0) {
+                continue;
+            }
+
+            if (this->relations.cleanup(relation) == RelationCleanup::Cascade) {
+                cascade.insert(cascade.end(), archetype->entityData(), archetype->entityData() + archetype->length());
+                continue;
+            }
+
+            // Rows lose the wildcard too when the pair was their last one of the relation.
+            auto bitmask = Signature::of(id);
+
+            if ((archetype->bitmask() & this->relations.pairs(relation)) == bitmask) {
+                bitmask.set(relation);
+            }
+
+            if (this->hasHooks(ComponentEvent::Remove, bitmask)) [[unlikely]] {
+                this->callHooks(ComponentEvent::Remove, bitmask, std::span<const Entity>(archetype->entityData(), archetype->length()));
+            }
+
+            const auto& edge = this->archetypes.removeEdge(index, bitmask);
+            this->archetypes.moveAll(index, edge, &this->entities, this->changeTick());
+        }
+    }
+
+    // Despawning the holders releases pairs targeting them in turn, so a cascade walks down the hierarchy.
+    if (!cascade.empty()) {
+        this->despawnBatch(cascade);
+    }
+
+    for (auto id : released) {
+        for (std::size_t event = 0; event < this->_hooks.size(); ++event) {
+            if (this->_hooked[event].test(id)) {
+                this->setHook(id, ComponentEvent(event), nullptr);
+            }
+        }
+
+        this->relations.release(id);
+    }
 }
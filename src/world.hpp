@@ -1,31 +1,97 @@
 #pragma once
 
 #include "bundle.hpp"
+#include "command_buffer.hpp"
 #include "components.hpp"
 #include "entity.hpp"
 #include "archetype.hpp"
 #include "query.hpp"
+#include "relation.hpp"
+#include "thread_pool.hpp"
+#include "tick.hpp"
+#include "world_view.hpp"
 
+#include <atomic>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/// Lifecycle events of a component, observed by hooks.
+enum class ComponentEvent : std::uint8_t {
+    /// Entities gained the component. Hooks run once the new values are in place.
+    Add,
+    /// An insert is about to overwrite the entities' component. Hooks run while the old values are readable.
+    Replace,
+    /// Entities are about to lose the component, by removal or despawn. Hooks run while the values are readable.
+    Remove,
+};
+
+/// Called with the entities an event happened to. A call covers the entities of a single transition, so
+/// batch operations and flushed commands call it once per archetype instead of once per entity. Hooks must
+/// not change the world's structure nor its hooks, structural changes go through `World::commands`.
+using ComponentHook = std::function<void(World& world, component_id id, std::span<const Entity> entities)>;
 
 class World {
+    friend class Scheduler;
+    friend class CommandBuffer;
+
 public:
     Entities entities;
     Archetypes archetypes;
     std::shared_ptr<Components> components;
+    Relations relations;
 
 public:
     explicit World();
 
-    component_id registerComponent(const TypeInfo typeInfo) {
-        return this->components->registerComponent(typeInfo);
+    /// Returns the tick stamped on components added or changed from now on.
+    Tick changeTick() const;
+
+    /// Advances the change tick and returns the previous one. Queries run at the returned tick, so every
+    /// later change is newer than their last run.
+    Tick incrementChangeTick();
+
+    /// Sets the change tick, when restoring components whose ticks come from another run.
+    void setChangeTick(Tick tick);
+
+    /// Clamps every stored tick to the maximum age once the change tick advanced by `tickCheckInterval`
+    /// since the last pass, so change filters stay right when the tick wraps around. Iteration and `flush`
+    /// call it. Must not run concurrently with anything else touching the world.
+    void checkChangeTicks();
+
+    /// Registers a component. Sparse components live in a sparse set instead of archetype columns, so
+    /// inserting and removing them never moves the entity's other components.
+    component_id registerComponent(const TypeInfo typeInfo, StorageType storage = StorageType::Table) {
+        auto id = this->components->registerComponent(typeInfo, storage);
+
+        if (storage == StorageType::Sparse) {
+            this->archetypes.addSparseSet(id, typeInfo);
+        }
+
+        return id;
     }
 
     template<typename T>
-    component_id registerComponent() {
-        auto id = components->registerComponent<T>();
+    component_id registerComponent(StorageType storage = StorageType::Table) {
+        auto id = components->registerComponent<T>(storage);
+
+        if (storage == StorageType::Sparse) {
+            this->archetypes.addSparseSet(id, TypeInfo::Of<T>());
+        }
+
         return id;
     }
 
@@ -34,20 +100,215 @@ public:
         return components->getId<T>();
     }
 
+    /// Registers a relation, an empty type naming how entities relate to targets, like a child to its parent.
+    /// Pairs of the relation are tags, so entities with the same target share an archetype, and `With<R>` in a
+    /// query matches entities holding any pair of R. The cleanup decides what happens to them when their
+    /// target is despawned. Pairs share the component id space: every live pair takes an id until its
+    /// target is despawned, so components, relations and live pairs together are capped at
+    /// WECS_MAX_COMPONENTS. Creating a pair past that throws.
+    template<typename R>
+    component_id registerRelation(RelationCleanup cleanup = RelationCleanup::Remove) {
+        static_assert(std::is_empty_v<R>, "Relations are tags, pairs carry no data");
+
+        auto id = this->registerComponent<R>();
+        this->relations.addRelation(id, cleanup);
+        return id;
+    }
+
+    /// Returns the component id of the pair, creating it on first use. Queries and bundles take it like any
+    /// tag. Throws when the pair doesn't exist yet and the target isn't alive, or every component id is taken.
+    component_id pair(component_id relation, Entity target);
+
+    template<typename R>
+    component_id pair(Entity target) {
+        return this->pair(this->getComponentId<R>(), target);
+    }
+
+    /// Adds the pair to the entity, moving it to the archetype of entities with the same pairs.
+    void addPair(Entity entity, component_id relation, Entity target);
+
+    template<typename R>
+    void addPair(Entity entity, Entity target) {
+        this->addPair(entity, this->getComponentId<R>(), target);
+    }
+
+    /// Removes the pair from the entity, along with the relation when it was the entity's last pair of it.
+    void removePair(Entity entity, component_id relation, Entity target);
+
+    template<typename R>
+    void removePair(Entity entity, Entity target) {
+        this->removePair(entity, this->getComponentId<R>(), target);
+    }
+
+    /// Returns the target of the entity's `index`-th pair of the relation, in id order, if it has that many.
+    std::optional<Entity> target(Entity entity, component_id relation, std::size_t index = 0);
+
+    template<typename R>
+    std::optional<Entity> target(Entity entity, std::size_t index = 0) {
+        return this->target(entity, this->getComponentId<R>(), index);
+    }
+
+    /// Appends every entity below `root` over the relation in breadth-first order: the entities targeting it,
+    /// then the ones targeting those, and so on. Every entity is visited once. Children are found per
+    /// archetype, never per row.
+    void descendants(component_id relation, Entity root, std::vector<Entity>& out);
+
+    template<typename R>
+    void descendants(Entity root, std::vector<Entity>& out) {
+        this->descendants(this->getComponentId<R>(), root, out);
+    }
+
+    /// Appends the entity's targets over the relation in breadth-first order, then their targets, and so on.
+    void ancestors(component_id relation, Entity entity, std::vector<Entity>& out);
+
+    /// Replaces the pairs with another world's, see Relations::pairData, registering pair ids this world
+    /// doesn't have yet. Used by snapshots and deltas. Throws when a pair's relation isn't registered as a
+    /// relation here.
+    void restorePairs(std::span<const RelationPair> pairs, std::span<const component_id> free);
+
+    template<typename R>
+    void ancestors(Entity entity, std::vector<Entity>& out) {
+        this->ancestors(this->getComponentId<R>(), entity, out);
+    }
+
+    /// Sets the hook called on the component's event, replacing the previous one. An empty hook removes it.
+    /// Hooks fire from inserts, removals, despawns, batch operations and flushed commands. Loading snapshots
+    /// and applying deltas write storage directly and only fire hooks of despawns. While no hook is set for
+    /// the components involved, operations pay a single bitmask test.
+    void setHook(component_id id, ComponentEvent event, ComponentHook hook);
+
+    template<typename T>
+    void onAdd(ComponentHook hook) {
+        this->setHook(this->getComponentId<T>(), ComponentEvent::Add, std::move(hook));
+    }
+
+    template<typename T>
+    void onReplace(ComponentHook hook) {
+        this->setHook(this->getComponentId<T>(), ComponentEvent::Replace, std::move(hook));
+    }
+
+    template<typename T>
+    void onRemove(ComponentHook hook) {
+        this->setHook(this->getComponentId<T>(), ComponentEvent::Remove, std::move(hook));
+    }
+
     Entity spawnEmpty();
+
+    /// Reserves an entity from any thread, see Entities::reserve. It exists after the next `flush`, and
+    /// commands recorded for it before then apply to it.
+    Entity reserveEntity();
+
     Entity spawnBundle(std::unique_ptr<Bundle> bundle);
+    /// Spawns an entity from a bundle, which may live on the caller's stack.
+    Entity spawnBundle(const Bundle& bundle);
 
+    /// Spawns an entity with the components, which are copied or moved straight into storage without
+    /// allocating a bundle.
     template<typename... Components>
     Entity spawn(Components&&... components) {
-        auto bundle = this->createBundle(components...);
         auto entity = this->spawnEmpty();
 
-        this->insertBundle(entity, std::move(bundle));
+        if constexpr (sizeof...(Components) > 0) {
+            this->insertComponents(entity, std::forward<Components>(components)...);
+        }
 
         return entity;
     }
 
+    /// Spawns one entity per element of the spans, which must all have the same length. Columns are reserved
+    /// once, trivially copyable components are copied with a single memcpy per column.
+    template<typename... Comps>
+    std::vector<Entity> spawnBatch(std::span<const Comps>... columns) {
+        static_assert(sizeof...(Comps) > 0, "Batch needs at least one component");
+
+        const std::size_t count = std::get<0>(std::forward_as_tuple(columns...)).size();
+        assert(((columns.size() == count) && ...) && "Columns of a batch must have the same length");
+
+        std::vector<Entity> entities(count);
+        std::size_t row = 0;
+        auto bitmask = this->createBitmask<Comps...>();
+        auto archetype = this->allocateBatch(bitmask, count, entities.data(), row);
+
+        (..., [&]() {
+            auto source = columns.data();
+
+            if constexpr (std::is_empty_v<Comps>) {
+                return;
+            }
+
+            if (auto set = this->archetypes.sparseSet(this->getComponentId<Comps>())) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    this->insertSparse(set, entities[i], source[i]);
+                }
+                return;
+            }
+
+            archetype->getColumn(this->getComponentId<Comps>())->forEachRange(row, count, [&](std::byte* bytes, std::size_t run) {
+                auto destination = reinterpret_cast<Comps*>(bytes);
+
+                if constexpr (TriviallyCopyable<Comps>) {
+                    std::memcpy(static_cast<void*>(destination), source, run * sizeof(Comps));
+                } else {
+                    std::uninitialized_copy_n(source, run, destination);
+                }
+
+                source += run;
+            });
+        }());
+
+        if (this->hasHooks(ComponentEvent::Add, bitmask)) [[unlikely]] {
+            this->callHooks(ComponentEvent::Add, bitmask, entities);
+        }
+
+        return entities;
+    }
+
+    /// Spawns one entity per element of the range. Elements are tuples holding every component, which
+    /// are copied into the columns reserved for the whole range.
+    template<typename... Comps, std::forward_iterator Iterator>
+    std::vector<Entity> spawnBatch(Iterator begin, Iterator end) {
+        static_assert(sizeof...(Comps) > 0, "Batch needs at least one component");
+
+        const auto count = std::size_t(std::distance(begin, end));
+
+        std::vector<Entity> entities(count);
+        std::size_t row = 0;
+        auto bitmask = this->createBitmask<Comps...>();
+        auto archetype = this->allocateBatch(bitmask, count, entities.data(), row);
+
+        SparseSet* sets[] = { this->archetypes.sparseSet(this->getComponentId<Comps>())... };
+        BlobVector* destinations[] = { archetype->bitmask().test(this->getComponentId<Comps>()) ? archetype->getColumn(this->getComponentId<Comps>()) : nullptr... };
+
+        for (std::size_t i = 0; begin != end; ++begin, ++i) {
+            const auto& element = *begin;
+            std::size_t column = 0;
+
+            (..., [&]() {
+                if constexpr (std::is_empty_v<Comps>) {
+                    // Tags have no column to write to.
+                } else if (sets[column] != nullptr) {
+                    this->insertSparse(sets[column], entities[i], std::get<Comps>(element));
+                } else {
+                    new (destinations[column]->template get<Comps>(row + i)) Comps(std::get<Comps>(element));
+                }
+                column++;
+            }());
+        }
+
+        if (this->hasHooks(ComponentEvent::Add, bitmask)) [[unlikely]] {
+            this->callHooks(ComponentEvent::Add, bitmask, entities);
+        }
+
+        return entities;
+    }
+
+    /// Spawns `count` entities from SoA arrays of raw component bytes, one array per component of the bitmask
+    /// in id order. Components that aren't trivially relocatable are move constructed out of the arrays.
+    /// Arrays of tags are never read and may be null.
+    void spawnBatch(const Signature& bitmask, std::size_t count, std::byte* const* columns, Entity* out);
+
     void insertBundle(Entity entity, std::unique_ptr<Bundle> bundle);
+    void insertBundle(Entity entity, const Bundle& bundle);
 
     template<typename... Components>
     void insert(Entity entity, Components&&... components) {
@@ -55,72 +316,528 @@ public:
             throw std::runtime_error("Entity is not alive while trying to insert components");
         }
 
-        auto bundle = this->createBundle(components...);
-        this->insertBundle(entity, std::move(bundle));
+        this->insertComponents(entity, std::forward<Components>(components)...);
     }
 
     void removeBundle(Entity entity, std::unique_ptr<Bundle> bundle);
 
+    /// Removes the components of the bitmask the entity has.
+    void removeComponents(Entity entity, const Signature& bitmask);
+
     template<typename... Components>
     void remove(Entity entity) {
         if (!this->entities.isAlive(entity)) {
             throw std::runtime_error("Entity is not alive while trying to remove components");
         }
 
-        auto bundle = std::make_unique<Bundle>(this->createBitmask<Components...>());
-        this->removeBundle(entity, std::move(bundle));
+        this->removeComponents(entity, this->createBitmask<Components...>());
     }
 
+    /// Returns the component's bytes and marks it as changed. Tags give tagAddress() when the entity has them.
     std::byte* get(Entity entity, component_id componentId);
 
+    /// Returns the component, marking it as changed unless `T` is const. Tags have no data, so they give
+    /// tagAddress() when the entity has them and null otherwise.
     template<typename T>
     T* get(Entity entity) {
         if (!this->entities.isAlive(entity)) {
             throw std::runtime_error("Entity is not alive while trying to get component");
         }
 
+        using Component = std::remove_const_t<T>;
+
+        auto id = components->getId<Component>();
+
+        if (auto set = this->archetypes.sparseSet(id)) {
+            auto row = set->row(entity.id);
+
+            if (row == SparseSet::npos) {
+                return nullptr;
+            }
+
+            if constexpr (!std::is_const_v<T>) {
+                set->dense().markChanged(row, 1, this->changeTick());
+            }
+
+            return set->dense().template get<Component>(row);
+        }
+
         auto location = this->entities.getLocation(entity).value();
         auto archetype = this->archetypes.at(location.archetype);
-        auto column = archetype->getColumn(components->getId<T>());
-        return column->template Get<T>(location.row);
+
+        if constexpr (std::is_empty_v<Component>) {
+            return archetype->bitmask().test(id) ? reinterpret_cast<Component*>(tagAddress()) : nullptr;
+        }
+
+        auto column = archetype->getColumn(id);
+
+        if constexpr (!std::is_const_v<T>) {
+            column->markChanged(location.row, 1, this->changeTick());
+        }
+
+        return column->template get<Component>(location.row);
     }
 
     void despawn(Entity entity);
 
+    /// Despawns every entity of the list. Rows are grouped by archetype and removed from the highest row
+    /// down, archetypes losing all of their rows are cleared at once.
+    void despawnBatch(std::span<const Entity> entities);
+
+    /// Despawns every entity matching the query by clearing the matching archetypes wholesale. Queries
+    /// requiring sparse components despawn the rows holding them through despawnBatch instead.
+    void despawnMatching(Query& query);
+
+    /// Despawns every entity matching `Comps`. Change filters are tested row by row like in `iter`, and
+    /// count as a run of the query.
+    template<typename... Comps>
+    void despawnMatching() {
+        if constexpr (queryFiltersRows<Comps...>) {
+            std::vector<Entity> matched;
+            this->collectMatching<Comps...>(matched);
+            this->despawnBatch(matched);
+        } else {
+            this->despawnMatching(this->query<Comps...>());
+        }
+    }
+
+    /// Inserts a copy of the value into every entity of the list, replacing the component where it exists.
+    template<typename T>
+    void insertBatch(std::span<const Entity> entities, const T& value) {
+        auto id = this->getComponentId<T>();
+        auto hooked = this->hasHooks(Signature::of(id));
+
+        if (hooked) [[unlikely]] {
+            this->_hookEntities.clear();
+
+            for (auto entity : entities) {
+                if (this->entities.isAlive(entity) && this->componentsOf(entity, Signature::of(id)).test(id)) {
+                    this->_hookEntities.push_back(entity);
+                }
+            }
+
+            this->callHooks(ComponentEvent::Replace, Signature::of(id), this->_hookEntities);
+            this->_hookEntities.clear();
+        }
+
+        if (auto set = this->archetypes.sparseSet(id)) {
+            for (auto entity : entities) {
+                if (this->entities.isAlive(entity)) {
+                    if (hooked && !set->contains(entity.id)) [[unlikely]] {
+                        this->_hookEntities.push_back(entity);
+                    }
+
+                    this->locate(entity);
+                    this->insertSparse(set, entity, value);
+                }
+            }
+
+            if (hooked) [[unlikely]] {
+                this->callHooks(ComponentEvent::Add, Signature::of(id), this->_hookEntities);
+            }
+            return;
+        }
+
+        for (auto entity : entities) {
+            if (this->entities.isAlive(entity) && !this->entities.isEmpty(entity)) {
+                auto location = this->entities.getLocation(entity).value();
+                auto archetype = this->archetypes.at(location.archetype);
+
+                // Tags have nothing to replace.
+                if (!std::is_empty_v<T> && archetype->bitmask().test(id)) {
+                    auto column = archetype->getColumn(id);
+
+                    *column->template get<T>(location.row) = value;
+                    column->markChanged(location.row, 1, this->changeTick());
+                }
+            }
+        }
+
+        const auto& ranges = this->transitionBatch(entities, Signature::of(id), true);
+        this->fillBatch(ranges, id, value);
+
+        if (hooked) [[unlikely]] {
+            this->callHooks(ComponentEvent::Add, id, ranges);
+        }
+    }
+
+    /// Inserts a copy of the value into every entity matching `Comps`, replacing the component where it exists.
+    /// Change filters are tested row by row like in `iter`, and count as a run of the query.
+    template<typename T, typename... Comps>
+    void insertMatching(const T& value) {
+        if constexpr (queryFiltersRows<Comps...>) {
+            std::vector<Entity> matched;
+            this->collectMatching<Comps...>(matched);
+            this->insertBatch(std::span<const Entity>(matched), value);
+            return;
+        }
+
+        auto& query = this->query<Comps...>();
+
+        if (!query.requiredSparse().empty()) {
+            std::vector<Entity> matched;
+            this->collectSparseMatching(query, matched);
+            this->insertBatch(std::span<const Entity>(matched), value);
+            return;
+        }
+        auto id = this->getComponentId<T>();
+        auto hooked = this->hasHooks(Signature::of(id));
+
+        if (auto set = this->archetypes.sparseSet(id)) {
+            for (auto index : query.matching()) {
+                auto archetype = this->archetypes.at(index);
+                auto rows = std::span<const Entity>(archetype->entityData(), archetype->length());
+
+                if (hooked) [[unlikely]] {
+                    this->_hookEntities.clear();
+                    std::ranges::copy_if(rows, std::back_inserter(this->_hookEntities), [&](Entity entity) {
+                        return !set->contains(entity.id);
+                    });
+                    this->callHooks(ComponentEvent::Replace, Signature::of(id), rows);
+                }
+
+                for (std::size_t row = 0; row < archetype->length(); ++row) {
+                    this->insertSparse(set, archetype->getEntity(row), value);
+                }
+
+                if (hooked) [[unlikely]] {
+                    this->callHooks(ComponentEvent::Add, Signature::of(id), this->_hookEntities);
+                }
+            }
+            return;
+        }
+
+        for (auto index : query.matching()) {
+            auto archetype = this->archetypes.at(index);
+
+            if (hooked && archetype->bitmask().test(id)) [[unlikely]] {
+                this->callHooks(ComponentEvent::Replace, Signature::of(id), std::span<const Entity>(archetype->entityData(), archetype->length()));
+            }
+
+            if (!std::is_empty_v<T> && archetype->bitmask().test(id)) {
+                auto column = archetype->getColumn(id);
+
+                column->forEachRange(0, column->length(), [&](std::byte* bytes, std::size_t run) {
+                    std::fill_n(reinterpret_cast<T*>(bytes), run, value);
+                });
+                column->markChanged(0, column->length(), this->changeTick());
+            }
+        }
+
+        const auto& ranges = this->transitionMatching(query, Signature::of(id), true);
+        this->fillBatch(ranges, id, value);
+
+        if (hooked) [[unlikely]] {
+            this->callHooks(ComponentEvent::Add, id, ranges);
+        }
+    }
+
+    template<typename... Comps>
+    void removeBatch(std::span<const Entity> entities) {
+        auto bitmask = this->createBitmask<Comps...>();
+        auto sparse = bitmask & this->archetypes.sparseMask();
+
+        sparse.forEach([&](component_id id) {
+            if (this->hasHooks(ComponentEvent::Remove, Signature::of(id))) [[unlikely]] {
+                this->_hookEntities.clear();
+                std::ranges::copy_if(entities, std::back_inserter(this->_hookEntities), [&](Entity entity) {
+                    return this->entities.isAlive(entity);
+                });
+
+                // Entities listed twice lose the component once.
+                std::ranges::sort(this->_hookEntities, {}, &Entity::id);
+                this->_hookEntities.erase(std::unique(this->_hookEntities.begin(), this->_hookEntities.end()), this->_hookEntities.end());
+
+                this->callHooks(ComponentEvent::Remove, Signature::of(id), this->_hookEntities);
+            }
+
+            for (auto entity : entities) {
+                if (this->entities.isAlive(entity)) {
+                    this->archetypes.sparseSet(id)->remove(entity.id);
+                }
+            }
+        });
+
+        this->transitionBatch(entities, bitmask & ~sparse, false);
+    }
+
+    /// Removes `Remove` components from every entity matching the query.
+    template<typename... Remove>
+    void removeMatching(Query& query) {
+        query.update(&this->archetypes, &this->entities);
+
+        if (!query.requiredSparse().empty()) {
+            std::vector<Entity> matched;
+            this->collectSparseMatching(query, matched);
+            this->removeBatch<Remove...>(matched);
+            return;
+        }
+
+        auto bitmask = this->createBitmask<Remove...>();
+        auto sparse = bitmask & this->archetypes.sparseMask();
+
+        if (!sparse.empty()) {
+            query.update(&this->archetypes, &this->entities);
+
+            for (auto index : query.matching()) {
+                auto archetype = this->archetypes.at(index);
+
+                if (this->hasHooks(ComponentEvent::Remove, sparse)) [[unlikely]] {
+                    this->callHooks(ComponentEvent::Remove, sparse, std::span<const Entity>(archetype->entityData(), archetype->length()));
+                }
+
+                for (std::size_t row = 0; row < archetype->length(); ++row) {
+                    sparse.forEach([&](component_id id) {
+                        this->archetypes.sparseSet(id)->remove(archetype->getEntity(row).id);
+                    });
+                }
+            }
+        }
+
+        this->transitionMatching(query, bitmask & ~sparse, false);
+    }
+
+    /// Rows of an archetype that received components during a bulk transition and still have to be
+    /// initialized.
+    struct BatchRange {
+        std::size_t archetype;
+        std::size_t row;
+        std::size_t count;
+    };
+
+    /// Moves every entity of the list over the insert or remove edge of the bitmask. Entities are grouped by
+    /// archetype, an archetype whose rows all move is moved wholesale, others move row by row from the
+    /// highest row down. Returns row ranges whose inserted components are left uninitialized.
+    const std::vector<BatchRange>& transitionBatch(std::span<const Entity> entities, const Signature& bitmask, bool insert);
+
+    /// Moves every archetype matching the query wholesale over the insert or remove edge of the bitmask.
+    /// Queries requiring sparse components move the rows holding them through transitionBatch instead.
+    const std::vector<BatchRange>& transitionMatching(Query& query, const Signature& bitmask, bool insert);
+
+    /// Returns the query registered for the given components, creating it on first use. The query is owned
+    /// by the world and only matches archetypes created since its last update.
+    template<typename... Comps>
+    Query& query() {
+        static const std::size_t slot = Query::nextSlot();
+
+        if (slot >= this->_queries.size()) {
+            this->_queries.resize(slot + 1);
+        }
+
+        auto& query = this->_queries[slot];
+        if (!query) {
+            query = std::make_unique<Query>(queryFetch<Comps...>(*this->components), queryFilter<Comps...>(*this->components));
+        }
+
+        query->update(&this->archetypes, &this->entities);
+        return *query;
+    }
+
+    /// Calls `func` for every matching entity. Terms are components, Entity, `Option<T>` passed as a pointer
+    /// that is null when the entity lacks T, or filters like `Without<T>` and `Changed<T>`, which narrow the
+    /// entities without being passed to `func`. Non-const components are marked as changed. Tags match like
+    /// `With<T>` and are passed as a reference without data.
     template<typename... Comps, typename Func>
     void iter( Func&& func) {
-        auto query = Query();
-        auto bitmask = this->createBitmask<Comps...>();
-        query.fetch(&this->archetypes, bitmask);
-        query.template iterate<Comps...>(std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{});
+        this->checkChangeTicks();
+
+        auto& query = this->query<Comps...>();
+        query.template iterate<Comps...>(this->incrementChangeTick(), std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{});
     }
 
+    /// Calls `func` once per chunk of matching entities with a QueryChunkInfo followed by a std::span per term,
+    /// so kernels can process rows in bulk. Entity gives a span of entities, `Option<T>` an empty span where
+    /// the chunk lacks T. Change filters skip whole chunks only.
+    template<typename... Comps, typename Func>
+    void iterChunks(Func&& func) {
+        this->checkChangeTicks();
+
+        auto& query = this->query<Comps...>();
+        query.template iterateChunks<Comps...>(this->incrementChangeTick(), std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{});
+    }
+
+    /// Iterates matching entities on the world's thread pool in batches of at least `minBatch` rows. The
+    /// callback is called concurrently and must not change the world's structure.
+    template<typename... Comps, typename Func>
+    void parIter(Func&& func, std::size_t minBatch = 1024) {
+        this->checkChangeTicks();
+
+        auto& query = this->query<Comps...>();
+        query.template parallelIterate<Comps...>(
+            this->threadPool(), this->incrementChangeTick(), minBatch, std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{}
+        );
+    }
+
+    /// Takes a read-only view of the components for another thread to iterate, sharing the chunks that
+    /// didn't change since `previous` with it. See WorldView.
+    template<typename... Comps>
+    WorldView view(const WorldView* previous = nullptr) {
+        return WorldView(*this, this->createBitmask<Comps...>(), previous);
+    }
+
+    /// Returns the thread pool used for parallel iteration, creating it on first use.
+    ThreadPool& threadPool();
+
+    /// Replaces the thread pool with one running the given number of workers, zero picks the hardware concurrency.
+    /// Pending commands are applied first.
+    void setThreadCount(std::size_t threadCount);
+
+    /// Returns the command buffer of the calling thread. Pool workers record into their own, every other
+    /// thread gets one registered on its first call. Structural changes recorded there are safe to make
+    /// while iterating and take effect on the next `flush`.
+    CommandBuffer& commands();
+
+    /// Turns reserved entities into live ones, then merges command buffers of pool workers in worker order,
+    /// followed by those of outside threads in registration order, and applies them. Must not run concurrently with anything else touching the world.
+    void flush();
+
 private:
+    std::atomic<Tick> _changeTick = 1;
+    /// Change tick at the last pass of checkChangeTicks.
+    Tick _lastTickCheck = 0;
+    std::vector<std::unique_ptr<Query>> _queries;
+    std::unique_ptr<ThreadPool> _threadPool;
+    /// One command buffer per pool worker.
+    std::vector<std::unique_ptr<CommandBuffer>> _commandBuffers;
+    /// Command buffers of threads outside the pool, registered in the order they first recorded.
+    std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> _outsideBuffers;
+    std::mutex _outsideMutex;
+    /// Identifies the world in threads' caches of their outside buffer, unique across worlds.
+    std::uint64_t _outsideSerial;
+
+    /// Hook of every component id, per event.
+    std::array<std::vector<ComponentHook>, 3> _hooks;
+    /// Components with a hook, per event.
+    std::array<Signature, 3> _hooked;
+    Signature _anyHooked;
+
+    /// Scratch space of bulk operations.
+    std::vector<std::pair<std::size_t, std::size_t>> _batchRows;
+    std::vector<std::size_t> _batchArchetypes;
+    std::vector<BatchRange> _batchRanges;
+    std::vector<Entity> _hookEntities;
+
+    /// Returns whether a component of the bitmask has a hook for any event.
+    bool hasHooks(const Signature& bitmask) const {
+        return bitmask.intersects(this->_anyHooked);
+    }
+
+    bool hasHooks(ComponentEvent event, const Signature& bitmask) const {
+        return bitmask.intersects(this->_hooked[std::size_t(event)]);
+    }
+
+    /// Calls the event's hooks of components of the bitmask with the entities. Entities lacking a sparse
+    /// component are left out of its call.
+    void callHooks(ComponentEvent event, const Signature& bitmask, std::span<const Entity> entities);
+
+    /// Calls the event's hook of the component with the rows of every range.
+    void callHooks(ComponentEvent event, component_id id, const std::vector<BatchRange>& ranges);
+
+    /// Returns the components of the bitmask the entity has, sparse ones included.
+    Signature componentsOf(Entity entity, const Signature& bitmask);
+
+    /// Cleans up pairs targeting the despawned entities: holders lose the pair, or are despawned in bulk when
+    /// the relation cascades. Ids of the pairs are then free for new pairs.
+    void releaseTargets(std::span<const Entity> despawned);
+
+    /// Appends the entities of every row matching `Comps`, so bulk operations can honor filters that reject
+    /// single rows. Terms are fetched as const, so nothing is marked as changed.
+    template<typename... Comps>
+    void collectMatching(std::vector<Entity>& out) {
+        auto& query = this->query<Comps...>();
+
+        query.template iterate<Entity, const Comps...>(this->incrementChangeTick(), [&](Entity entity, const auto&...) {
+            out.push_back(entity);
+        }, std::make_index_sequence<sizeof...(Comps) + 1>{});
+    }
+
+    /// Appends the entities of the query's chunks that hold every required sparse component. The query must
+    /// be updated with the world's entities, so chunks only hold rows of the smallest required set.
+    void collectSparseMatching(Query& query, std::vector<Entity>& out);
+
+    template<typename T>
+    void fillBatch(const std::vector<BatchRange>& ranges, component_id id, const T& value) {
+        if constexpr (std::is_empty_v<T>) {
+            return;
+        }
+
+        for (const auto& range : ranges) {
+            auto column = this->archetypes.at(range.archetype)->getColumn(id);
+
+            column->forEachRange(range.row, range.count, [&](std::byte* bytes, std::size_t run) {
+                std::uninitialized_fill_n(reinterpret_cast<T*>(bytes), run, value);
+            });
+        }
+    }
+
+    /// Creates `count` entities in the archetype of the bitmask's table components and returns it. Rows
+    /// starting at `row` are left uninitialized for the caller to fill, as are sparse components.
+    Archetype* allocateBatch(const Signature& bitmask, std::size_t count, Entity* out, std::size_t& row);
+
+    /// Puts an entity without components into the root archetype, so queries joining sparse components
+    /// can find it.
+    void locate(Entity entity);
+
+    /// Inserts a copy of the value as the entity's component in the sparse set.
+    template<typename T>
+    void insertSparse(SparseSet* set, Entity entity, T&& value) {
+        std::decay_t<T> copy(std::forward<T>(value));
+        set->insert(entity, reinterpret_cast<std::byte*>(&copy), this->changeTick());
+    }
+
+    /// Moves the entity to the archetype extended by the bitmask's table components and returns its new
+    /// location. Components it gains are left uninitialized, `previous` receives the bitmask it came from.
+    EntityLocation prepareInsert(Entity entity, const Signature& bitmask, Signature& previous);
 
     template<typename... Components>
-    std::unique_ptr<Bundle> createBundle(Components&&... components) const {
-        std::size_t totalSize = (sizeof(Components) + ...);
-        std::byte* buffer = static_cast<std::byte*>(::operator new(totalSize));
-        std::size_t offset = 0;
+    void insertComponents(Entity entity, Components&&... components) {
+        auto bitmask = this->createBitmask<Components...>();
+        auto hooked = this->hasHooks(bitmask);
+        Signature had;
 
-        (..., (
-            new (buffer + offset) std::decay_t<Components>(std::forward<Components>(components)),
-            offset += sizeof(Components)
-        ));
+        if (hooked) [[unlikely]] {
+            had = this->componentsOf(entity, bitmask);
+            this->callHooks(ComponentEvent::Replace, had, std::span(&entity, 1));
+        }
 
-        component_id mask = this->createBitmask<Components...>();
+        Signature previous;
+        auto location = this->prepareInsert(entity, bitmask, previous);
+        auto archetype = this->archetypes.at(location.archetype);
 
-        auto bundle = std::make_unique<Bundle>(this->components, mask, buffer, sizeof...(Components), true);
+        (..., this->writeComponent(archetype, location.row, previous, entity, std::forward<Components>(components)));
 
-        return bundle;
+        if (hooked) [[unlikely]] {
+            this->callHooks(ComponentEvent::Add, bitmask & ~had, std::span(&entity, 1));
+        }
+    }
+
+    /// Constructs the component in its column, or assigns it when the entity already had it.
+    template<typename T>
+    void writeComponent(Archetype* archetype, std::size_t row, const Signature& previous, Entity entity, T&& value) {
+        using Component = std::decay_t<T>;
+
+        // Tags have no storage to write to.
+        if constexpr (!std::is_empty_v<Component>) {
+            auto id = this->getComponentId<Component>();
+
+            if (auto set = this->archetypes.sparseSet(id)) {
+                this->insertSparse(set, entity, std::forward<T>(value));
+                return;
+            }
+
+            auto column = archetype->getColumn(id);
+
+            if (previous.test(id)) {
+                *column->template get<Component>(row) = std::forward<T>(value);
+                column->markChanged(row, 1, this->changeTick());
+            } else {
+                new (column->template get<Component>(row)) Component(std::forward<T>(value));
+            }
+        }
     }
 
     template<typename... Components>
-    component_id createBitmask() const {
-        return (
-            (std::is_same_v<std::decay_t<Components>, Entity> ? 0
-                : this->getComponentId<std::decay_t<Components>>())
-            | ... | 0
-        );
+    Signature createBitmask() const {
+        return componentBitmask<Components...>(*this->components);
     }
 };
@@ -0,0 +1,170 @@
+#include "world_view.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+WorldView::WorldView(World& world, const Signature& components, const WorldView* previous) {
+    assert(!components.intersects(world.archetypes.sparseMask()) && "Views capture table components only");
+
+    // The registry only grows, so an unchanged count means the previous view's copy is still accurate.
+    if (previous != nullptr && previous->_components && previous->_components->count() == world.components->count()) {
+        this->_components = previous->_components;
+    } else {
+        this->_components = std::make_shared<const Components>(*world.components);
+    }
+
+    this->_bitmask = components;
+    world.checkChangeTicks();
+    this->_tick = world.incrementChangeTick();
+
+    auto reuse = previous != nullptr && previous->_bitmask == components;
+    auto lastRun = reuse ? clampTick(previous->_tick, this->_tick) : Tick(0);
+    auto captured = components & ~world.components->tags();
+
+    auto& archetypes = world.archetypes.archetypes();
+    this->_archetypes.resize(archetypes.size());
+
+    for (std::size_t index = 0; index < archetypes.size(); ++index) {
+        auto& archetype = archetypes[index];
+
+        if (archetype.length() == 0 || !archetype.bitmask().intersects(components)) {
+            continue;
+        }
+
+        auto& view = this->_archetypes[index];
+        view.bitmask = archetype.bitmask();
+        view.chunkRows = archetype.chunkRows();
+
+        (captured & archetype.bitmask()).forEach([&](component_id id) {
+            if (!archetype.getColumn(id)->typeInfo().trivially_relocatable) {
+                throw std::runtime_error("Views can only capture trivially copyable components");
+            }
+
+            view.captured.push_back(id);
+        });
+
+        const ViewArchetype* old = nullptr;
+        if (reuse && index < previous->_archetypes.size() && previous->_archetypes[index].chunkRows == view.chunkRows) {
+            old = &previous->_archetypes[index];
+        }
+
+        view.chunks.reserve(archetype.chunkCount());
+
+        for (std::size_t page = 0; page < archetype.chunkCount(); ++page) {
+            auto begin = page * view.chunkRows;
+            auto length = std::min(view.chunkRows, archetype.length() - begin);
+
+            // A chunk is shared when the same entities sit in the same rows and no captured column of the
+            // page was written since the previous view. Rows moved by removals land on other entities.
+            auto unchanged = old != nullptr && page < old->chunks.size() && old->chunks[page]->length == length
+                && std::memcmp(old->chunks[page]->entities, archetype.entityData() + begin, length * sizeof(Entity)) == 0
+                && std::ranges::none_of(view.captured, [&](component_id id) {
+                    return isNewerTick(archetype.getColumn(id)->pageTicks(page)->latest, lastRun, this->_tick);
+                });
+
+            view.chunks.push_back(unchanged ? old->chunks[page] : this->copyChunk(archetype, view, page, length));
+        }
+
+        this->_length += archetype.length();
+    }
+}
+
+std::shared_ptr<const WorldView::Chunk> WorldView::copyChunk(Archetype& archetype, const ViewArchetype& view, std::size_t page, std::size_t length) {
+    auto align = [](std::size_t offset) {
+        return (offset + Archetype::chunkAlign - 1) / Archetype::chunkAlign * Archetype::chunkAlign;
+    };
+
+    std::vector<std::size_t> offsets;
+    offsets.reserve(view.captured.size());
+
+    auto bytes = length * sizeof(Entity);
+    for (auto id : view.captured) {
+        bytes = align(bytes);
+        offsets.push_back(bytes);
+        bytes += length * archetype.getColumn(id)->typeInfo().size;
+    }
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->memory.reset(static_cast<std::byte*>(operator new(bytes, std::align_val_t{Archetype::chunkAlign})));
+    chunk->length = length;
+
+    auto memory = chunk->memory.get();
+    std::memcpy(memory, archetype.entityData() + page * view.chunkRows, length * sizeof(Entity));
+    chunk->entities = reinterpret_cast<const Entity*>(memory);
+
+    for (std::size_t i = 0; i < view.captured.size(); ++i) {
+        auto column = archetype.getColumn(view.captured[i]);
+
+        // Pages start at the chunk's first row, contiguous columns are a single page.
+        std::memcpy(memory + offsets[i], column->page(page), length * column->typeInfo().size);
+        chunk->columns.push_back(memory + offsets[i]);
+    }
+
+    this->_copiedBytes += bytes;
+    return chunk;
+}
+
+void WorldView::fill(Query& query) const {
+    const auto& fetch = query.fetched();
+    const auto termCount = fetch.size();
+
+    assert(std::ranges::all_of(fetch, [&](component_id id) { return this->_bitmask.test(id); })
+        && "Component isn't part of the view");
+
+    std::size_t chunkCount = 0;
+    for (const auto& archetype : this->_archetypes) {
+        if (!archetype.chunks.empty() && query.matches(archetype.bitmask)) {
+            chunkCount += archetype.chunks.size();
+        }
+    }
+
+    query.columns.resize(chunkCount * termCount);
+    query.chunks.resize(chunkCount);
+
+    std::vector<std::size_t> positions(termCount);
+    std::size_t chunk = 0;
+
+    for (const auto& archetype : this->_archetypes) {
+        if (archetype.chunks.empty() || !query.matches(archetype.bitmask)) {
+            continue;
+        }
+
+        for (std::size_t term = 0; term < termCount; ++term) {
+            auto position = std::ranges::find(archetype.captured, fetch[term]);
+            positions[term] = position != archetype.captured.end() ? std::size_t(position - archetype.captured.begin()) : QueryCache::absent;
+        }
+
+        for (const auto& rows : archetype.chunks) {
+            auto columns = query.columns.data() + chunk * termCount;
+
+            // Views are only iterated with const terms, so nothing ever writes through these pointers.
+            for (std::size_t term = 0; term < termCount; ++term) {
+                columns[term] = positions[term] == QueryCache::absent
+                    ? QueryColumn{}
+                    : QueryColumn{ const_cast<std::byte*>(rows->columns[positions[term]]), nullptr, nullptr, nullptr, nullptr };
+            }
+
+            query.chunks[chunk++] = QueryChunk{ columns, const_cast<Entity*>(rows->entities), rows->length, false, nullptr };
+        }
+    }
+}
+
+const Signature& WorldView::bitmask() const {
+    return this->_bitmask;
+}
+
+Tick WorldView::tick() const {
+    return this->_tick;
+}
+
+std::size_t WorldView::length() const {
+    return this->_length;
+}
+
+std::size_t WorldView::copiedBytes() const {
+    return this->_copiedBytes;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "archetype.hpp"
+#include "components.hpp"
+#include "entity.hpp"
+#include "query.hpp"
+#include "signature.hpp"
+#include "tick.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class World;
+
+/// Read-only copy of selected components of a world, taken at a sync point and iterated by another thread
+/// while the world moves on. Views are built chunk by chunk: a chunk whose entities and captured columns
+/// didn't change since the previous view is shared with it, only changed chunks are copied. Taking a view
+/// every tick thus costs memory and copies in proportion to what changed, and the live world is never
+/// locked nor written to. Chunks follow the archetype's blocks in chunked storage, contiguous archetypes are
+/// a single chunk.
+///
+/// Changes are found through change ticks, like a query with a `Changed` filter finds them, so components
+/// written through pointers the world handed out before the view was taken are only seen once marked again.
+class WorldView {
+public:
+    /// An empty view.
+    WorldView() = default;
+
+    /// Captures table components of the bitmask of every entity having at least one of them, on the world's
+    /// thread while nothing else touches it. Chunks that didn't change since `previous`, taken from the same
+    /// world, are shared instead of copied. Captured components must be trivially copyable. Advances the
+    /// change tick like an iteration does.
+    WorldView(World& world, const Signature& components, const WorldView* previous = nullptr);
+
+    /// Calls `func` for every matching entity of the view, with the terms of `World::iter`. Views are
+    /// read-only and keep no change ticks, so components are fetched as const and change filters aren't
+    /// available. Safe to call from any thread while the world is mutated.
+    template<typename... Comps, typename Func>
+    void iter(Func&& func) const {
+        static_assert(!(queryWrites<Comps> || ...), "Views are read-only, fetch components as const");
+        static_assert(!(IsChangeFilter<std::remove_cv_t<Comps>>::value || ...), "Views keep no change ticks");
+
+        if (!this->_components) {
+            return;
+        }
+
+        auto query = Query(queryFetch<Comps...>(*this->_components), queryFilter<Comps...>(*this->_components));
+        this->fill(query);
+        query.template iterate<Comps...>(this->_tick, std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{});
+    }
+
+    /// Calls `func` once per chunk of matching entities, with the spans of `World::iterChunks`.
+    template<typename... Comps, typename Func>
+    void iterChunks(Func&& func) const {
+        static_assert(!(queryWrites<Comps> || ...), "Views are read-only, fetch components as const");
+        static_assert(!(IsChangeFilter<std::remove_cv_t<Comps>>::value || ...), "Views keep no change ticks");
+
+        if (!this->_components) {
+            return;
+        }
+
+        auto query = Query(queryFetch<Comps...>(*this->_components), queryFilter<Comps...>(*this->_components));
+        this->fill(query);
+        query.template iterateChunks<Comps...>(this->_tick, std::forward<Func>(func), std::make_index_sequence<sizeof...(Comps)>{});
+    }
+
+    /// Returns the captured components.
+    const Signature& bitmask() const;
+    /// Returns the tick the view was taken at. Changes stamped later aren't part of it.
+    Tick tick() const;
+    /// Returns the number of captured entities.
+    std::size_t length() const;
+    /// Returns the bytes copied when the view was taken. Everything else is shared with the previous view.
+    std::size_t copiedBytes() const;
+
+private:
+    /// Rows of a chunk, entities first and every captured column after them.
+    struct Chunk {
+        std::unique_ptr<std::byte[], ChunkDeleter> memory;
+        std::size_t length = 0;
+        const Entity* entities = nullptr;
+        /// Start of every captured column, in the order of the archetype's captured components.
+        std::vector<const std::byte*> columns;
+    };
+
+    struct ViewArchetype {
+        Signature bitmask;
+        /// Captured components with a column, in id order.
+        std::vector<component_id> captured;
+        std::size_t chunkRows = 0;
+        std::vector<std::shared_ptr<const Chunk>> chunks;
+    };
+
+    /// Points the query's chunks at the view's chunks of matching archetypes.
+    void fill(Query& query) const;
+
+    /// Copies the rows of the archetype's page into a new chunk.
+    std::shared_ptr<const Chunk> copyChunk(Archetype& archetype, const ViewArchetype& view, std::size_t page, std::size_t length);
+
+    /// Registry of the captured world, copied so readers never race with components registered later.
+    std::shared_ptr<const Components> _components;
+    Signature _bitmask;
+    Tick _tick = 0;
+    std::size_t _length = 0;
+    std::size_t _copiedBytes = 0;
+    /// Captured archetypes, indexed like the world's. Archetypes without captured components are empty.
+    std::vector<ViewArchetype> _archetypes;
+};